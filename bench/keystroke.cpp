@@ -0,0 +1,401 @@
+// Keystroke benchmarks of the console and history hot paths.
+//
+// Drives headless consoles writing to a null output with synthetic workloads
+// and reports per-keystroke latency percentiles, bytes rendered and
+// allocations. A replay on a virtual terminal checks the screen after every
+// key and counts the escape sequences emitted.
+// Pass --quick to skip the workloads on 1M entry histories, and --metrics to
+// dump the metrics of each search workload if built with CONSOLE_METRICS.
+
+#include "console.h"
+#include "history.h"
+#include "virtualterminal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//--                          Allocation Counting                             --
+//------------------------------------------------------------------------------
+namespace {
+	std::atomic<size_t> allocations(0);
+}
+
+void *operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if(void *p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	std::free(p);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Indicator that paste and search workloads dump the console metrics.
+bool dumpMetrics = false;
+
+//------------------------------------------------------------------------------
+//--                             Class NullOutput                             --
+//------------------------------------------------------------------------------
+// Output discarding all bytes written to it.
+class NullOutput : public Console::Output {
+public:
+	virtual void write(char const *, size_t) override { }
+};
+
+//------------------------------------------------------------------------------
+//--                            Class BenchConsole                            --
+//------------------------------------------------------------------------------
+// Console adding every entered command to its history.
+class BenchConsole : public Console::Console {
+public:
+	BenchConsole(size_t historySize, ::Console::Output &output)
+	: Console(historySize, output, 0, false) { }
+	
+	using Console::history;
+	
+private:
+	virtual void onCommand(std::string command) override {
+		addHistory(std::move(command));
+	}
+};
+
+//------------------------------------------------------------------------------
+//--                               Class Stats                                --
+//------------------------------------------------------------------------------
+// Samples of a workload, one per keystroke.
+class Stats {
+public:
+	// Feed keys to the console as a single keystroke and record its cost.
+	void press(BenchConsole &console, std::string_view keys) {
+		size_t allocs = allocations.load(std::memory_order_relaxed);
+		Clock::time_point start = Clock::now();
+		console.feed(keys);
+		_latencies.push_back(Clock::now() - start);
+		_allocations += allocations.load(std::memory_order_relaxed) - allocs;
+		_bytes += console.renderedBytes();
+	}
+	
+	// Print the statistics of the workload.
+	void print(char const *name) {
+		if(_latencies.empty()) {
+			return;
+		}
+		std::sort(_latencies.begin(), _latencies.end());
+		size_t n = _latencies.size();
+		std::printf("%-24s %8zu %9.1f %9.1f %9.1f %9.1f %10.1f %10.2f\n", name, n,
+		            micros(percentile(0.50)), micros(percentile(0.90)),
+		            micros(percentile(0.99)), micros(_latencies.back()),
+		            double(_bytes) / n, double(_allocations) / n);
+	}
+	
+private:
+	Clock::duration percentile(double p) const {
+		return _latencies[std::min(_latencies.size() - 1,
+		                           size_t(p * _latencies.size()))];
+	}
+	static double micros(Clock::duration d) {
+		return std::chrono::duration<double, std::micro>(d).count();
+	}
+	
+private:
+	std::vector<Clock::duration> _latencies;
+	size_t _bytes = 0;
+	size_t _allocations = 0;
+};
+
+//------------------------------------------------------------------------------
+//--                             Synthetic Input                              --
+//------------------------------------------------------------------------------
+char const *const words[] = {
+	"git", "commit", "checkout", "make", "build", "ls", "grep", "docker", "run",
+	"push", "status", "-la", "config", "src", "test", "--verbose", "deploy"
+};
+
+// Generate a command line of a few words, made unique by a serial number.
+std::string command(std::mt19937 &rng, size_t serial) {
+	std::string line;
+	for(size_t i = 0, n = 2 + rng() % 5; i < n; ++i) {
+		line += words[rng() % (sizeof(words) / sizeof(*words))];
+		line += ' ';
+	}
+	line += std::to_string(serial);
+	return line;
+}
+
+// Generate text of the specified size without line breaks.
+std::string text(std::mt19937 &rng, size_t size) {
+	std::string result;
+	while(result.size() < size) {
+		result += command(rng, result.size());
+		result += ' ';
+	}
+	result.resize(size);
+	return result;
+}
+
+// Fill the history of the console with the specified number of entries.
+void fill(BenchConsole &console, size_t entries) {
+	std::mt19937 rng(1);
+	for(size_t i = 0; i < entries; ++i) {
+		console.history().push(command(rng, i));
+	}
+}
+
+//------------------------------------------------------------------------------
+//--                                Workloads                                 --
+//------------------------------------------------------------------------------
+char const *const left = "\033[D";
+char const *const right = "\033[C";
+char const *const up = "\033[A";
+char const *const ctrlC = "\x03";
+char const *const ctrlR = "\x12";
+
+// Type commands character by character, entering each of them.
+void typing() {
+	NullOutput output;
+	BenchConsole console(1000, output);
+	std::mt19937 rng(2);
+	Stats stats;
+	for(size_t i = 0; i < 500; ++i) {
+		for(char c : command(rng, i)) {
+			stats.press(console, std::string_view(&c, 1));
+		}
+		stats.press(console, "\r");
+	}
+	stats.print("typing");
+}
+
+// Paste large chunks of text as a single read each, optionally bracketed.
+void paste(size_t size, bool bracketed, char const *name) {
+	NullOutput output;
+	BenchConsole console(1000, output);
+	std::mt19937 rng(3);
+	std::string chunk = text(rng, size);
+	if(bracketed) {
+		chunk = "\033[200~" + chunk + "\033[201~";
+	}
+	Stats stats;
+	for(size_t i = 0; i < 20; ++i) {
+		stats.press(console, chunk);
+		console.feed(ctrlC);
+	}
+	stats.print(name);
+	if(dumpMetrics) {
+		console.metrics().dump(std::cout);
+	}
+}
+
+// Move the cursor across a long line and edit in its middle.
+void arrows() {
+	NullOutput output;
+	BenchConsole console(1000, output);
+	std::mt19937 rng(4);
+	console.feed(text(rng, 10000));
+	Stats stats;
+	for(size_t i = 0; i < 5000; ++i) {
+		stats.press(console, left);
+	}
+	for(size_t i = 0; i < 1000; ++i) {
+		stats.press(console, "x");
+		stats.press(console, "\x7f");
+		stats.press(console, right);
+	}
+	stats.print("arrows (10k line)");
+}
+
+// Browse the history with the up arrow.
+void browse(size_t entries, char const *name) {
+	NullOutput output;
+	BenchConsole console(entries, output);
+	fill(console, entries);
+	Stats stats;
+	for(size_t i = 0; i < std::min<size_t>(entries, 5000); ++i) {
+		stats.press(console, up);
+	}
+	stats.print(name);
+}
+
+// Search the history incrementally with Ctrl-R.
+void search(size_t entries, bool fuzzy, char const *name) {
+	NullOutput output;
+	BenchConsole console(entries, output);
+	fill(console, entries);
+	console.history().setFuzzy(fuzzy);
+	Stats stats;
+	for(char const *query : { "git co", "dock pu", "mk bld 9", "status 12" }) {
+		stats.press(console, ctrlR);
+		for(char const *c = query; *c; ++c) {
+			stats.press(console, std::string_view(c, 1));
+		}
+		stats.press(console, ctrlR);
+		stats.press(console, ctrlR);
+		console.feed(ctrlC);
+	}
+	stats.print(name);
+	if(dumpMetrics) {
+		console.metrics().dump(std::cout);
+	}
+}
+
+// Replay random edits on a virtual terminal, comparing the screen with a model
+// of the command line after every key.
+void replay() {
+	Console::VirtualTerminal terminal(200, 24);
+	BenchConsole console(1000, terminal);
+	std::mt19937 rng(6);
+	std::string line;
+	size_t cursor = 0;
+	size_t keys = 0;
+	size_t mismatches = 0;
+	terminal.resetCounters();
+	for(; keys < 20000; ++keys) {
+		unsigned key = rng() % 20;
+		if(key < 12 && line.size() < 150) {
+			char c = char('a' + rng() % 26);
+			console.feed(std::string_view(&c, 1));
+			line.insert(cursor++, 1, c);
+		} else if(key < 14) {
+			console.feed(left);
+			cursor -= cursor > 0;
+		} else if(key < 16) {
+			console.feed(right);
+			cursor += cursor < line.size();
+		} else if(key < 19) {
+			console.feed("\x7f");
+			if(cursor) {
+				line.erase(--cursor, 1);
+			}
+		} else {
+			console.feed("\r");
+			line.clear();
+			cursor = 0;
+		}
+		if(terminal.line(terminal.cursorRow()) != ": " + line ||
+		   terminal.cursorColumn() != 2 + cursor) {
+			++mismatches;
+		}
+	}
+	std::printf("%-24s %8zu %9s %9s %9s %9s %10.1f %10s  %.2f seqs/key, "
+	            "%zu mismatches\n", "screen replay", keys, "", "", "", "",
+	            double(terminal.bytes()) / keys, "",
+	            double(terminal.sequences()) / keys, mismatches);
+}
+
+// Enter many commands in large chunks of input, in batch mode or through the
+// line editor.
+void script(size_t commands, bool batch, char const *name) {
+	NullOutput output;
+	BenchConsole console(1000, output);
+	console.setBatch(batch);
+	std::mt19937 rng(6);
+	std::string input;
+	for(size_t i = 0; i < commands; ++i) {
+		input += command(rng, i);
+		input += '\n';
+	}
+	
+	size_t allocs = allocations.load(std::memory_order_relaxed);
+	Clock::time_point start = Clock::now();
+	for(size_t i = 0; i < input.size(); i += 64 * 1024) {
+		console.feed(input.data() + i, std::min<size_t>(64 * 1024,
+		                                                input.size() - i));
+	}
+	Clock::time_point end = Clock::now();
+	allocs = allocations.load(std::memory_order_relaxed) - allocs;
+	
+	double ms = std::chrono::duration<double, std::milli>(end - start).count();
+	std::printf("%-24s %8zu cmds  %8.1f ms  %6.2f M cmds/s  %.2f allocs/cmd\n",
+	            name, commands, ms, commands / ms / 1000,
+	            double(allocs) / commands);
+}
+
+// Save and load a large history file.
+void file(size_t entries, char const *name) {
+	std::string path = (std::filesystem::temp_directory_path() /
+	                    "console-bench.history").string();
+	Console::History history(entries);
+	std::mt19937 rng(5);
+	for(size_t i = 0; i < entries; ++i) {
+		history.push(command(rng, i));
+	}
+	
+	size_t allocs = allocations.load(std::memory_order_relaxed);
+	Clock::time_point start = Clock::now();
+	history.save(path, false);
+	Clock::time_point saved = Clock::now();
+	size_t saveAllocs = allocations.load(std::memory_order_relaxed) - allocs;
+	Console::History loaded(entries);
+	allocs = allocations.load(std::memory_order_relaxed);
+	Clock::time_point loadStart = Clock::now();
+	loaded.load(path, false);
+	Clock::time_point end = Clock::now();
+	size_t loadAllocs = allocations.load(std::memory_order_relaxed) - allocs;
+	
+	double mib = double(std::filesystem::file_size(path)) / (1024 * 1024);
+	std::printf("%-24s %7.1f MiB  save %8.1f ms (%zu allocs)  "
+	            "load %8.1f ms (%zu allocs)\n", name, mib,
+	            std::chrono::duration<double, std::milli>(saved - start).count(),
+	            saveAllocs,
+	            std::chrono::duration<double, std::milli>(end - loadStart).count(),
+	            loadAllocs);
+	std::filesystem::remove(path);
+}
+
+}
+
+int main(int argc, char **argv) {
+	bool quick = false;
+	for(int i = 1; i < argc; ++i) {
+		quick |= !std::strcmp(argv[i], "--quick");
+		dumpMetrics |= !std::strcmp(argv[i], "--metrics");
+	}
+	
+	std::printf("%-24s %8s %9s %9s %9s %9s %10s %10s\n", "workload", "keys",
+	            "p50 us", "p90 us", "p99 us", "max us", "bytes/key", "allocs/key");
+	typing();
+	paste(64 * 1024, false, "paste 64 KiB");
+	paste(1024 * 1024, false, "paste 1 MiB");
+	paste(64 * 1024, true, "bracketed paste 64 KiB");
+	paste(1024 * 1024, true, "bracketed paste 1 MiB");
+	arrows();
+	replay();
+	browse(100000, "up arrow (100k)");
+	search(1000, false, "ctrl-r (1k)");
+	search(100000, false, "ctrl-r (100k)");
+	search(1000, true, "fuzzy ctrl-r (1k)");
+	search(100000, true, "fuzzy ctrl-r (100k)");
+	if(!quick) {
+		search(1000000, false, "ctrl-r (1M)");
+		search(1000000, true, "fuzzy ctrl-r (1M)");
+	}
+	
+	std::printf("\n");
+	script(100000, false, "script (interactive)");
+	script(100000, true, "script (batch)");
+	file(100000, "history file (100k)");
+	if(!quick) {
+		file(1000000, "history file (1M)");
+	}
+	return 0;
+}
@@ -0,0 +1,83 @@
+// Micro-benchmark of the bulk utf8 functions against the scalar helpers.
+//
+// Built by the console-utf8-bench target.
+
+#include "utf8.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace {
+
+//------------------------------------------------------------------------------
+//--                           Scalar References                              --
+//------------------------------------------------------------------------------
+// Count codepoints by walking one codepoint at a time.
+size_t scalarCount(std::string const &str) {
+	size_t n = 0;
+	for(size_t pos = 0; pos < str.size(); pos = Console::Utf8::posNext(str, pos)) {
+		++n;
+	}
+	return n;
+}
+
+// Skip n codepoints by walking one codepoint at a time.
+size_t scalarAdvance(std::string const &str, size_t n) {
+	size_t pos = 0;
+	for(; n && pos < str.size(); --n) {
+		pos = Console::Utf8::posNext(str, pos);
+	}
+	return pos;
+}
+
+//------------------------------------------------------------------------------
+//--                             Measurement                                  --
+//------------------------------------------------------------------------------
+// Run f repeatedly and print the throughput in MiB/s.
+template<class F>
+void measure(char const *name, std::string const &input, F &&f) {
+	size_t const rounds = 200;
+	size_t sink = 0;
+	auto start = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < rounds; ++i) {
+		sink += f();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	double mib = double(input.size()) * rounds / (1024 * 1024);
+	std::printf("  %-16s %10.1f MiB/s  (%zu)\n", name, mib / elapsed.count(),
+	            sink / rounds);
+}
+
+// Build a line of the specified size with the given share of multi-octet text.
+std::string makeInput(size_t size, double nonAscii) {
+	static char const *const samples[] = { "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80" };
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<double> share(0, 1);
+	std::string input;
+	while(input.size() < size) {
+		if(share(rng) < nonAscii) {
+			input += samples[rng() % 3];
+		} else {
+			input += char('a' + rng() % 26);
+		}
+	}
+	return input;
+}
+
+}
+
+int main() {
+	for(double nonAscii : { 0.0, 0.1, 0.5 }) {
+		std::string input = makeInput(1 << 20, nonAscii);
+		size_t half = Console::Utf8::count(input) / 2;
+		std::printf("1 MiB line, %.0f%% multi-octet codepoints\n", nonAscii * 100);
+		measure("scalar count", input, [&] { return scalarCount(input); });
+		measure("count", input, [&] { return Console::Utf8::count(input); });
+		measure("scalar advance", input, [&] { return scalarAdvance(input, half); });
+		measure("advance", input, [&] { return Console::Utf8::advance(input, 0, half); });
+		measure("valid", input, [&] { return size_t(Console::Utf8::valid(input)); });
+	}
+	return 0;
+}
@@ -0,0 +1,180 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                               Class Arena                                --
+//------------------------------------------------------------------------------
+
+// Construct an arena holding at most maxEntries entries and maxBytes bytes.
+Arena::Arena(size_t maxEntries, size_t maxBytes)
+: _buffer(std::min<size_t>(maxBytes, 4096))
+, _maxBytes(maxBytes)
+, _bytes(0)
+, _slots(maxEntries)
+, _maxEntries(maxEntries)
+, _first(0)
+, _size(0)
+, _removed(0)
+, _removedBytes(0) { }
+
+// Check if the oldest entry must be removed before pushing an entry.
+bool Arena::full(size_t length) const {
+	if(_size - _removed >= _maxEntries) {
+		return true;
+	}
+	// The buffer may grow up to the byte limit.
+	return place(length) == npos &&
+	       (_buffer.size() >= _maxBytes || _bytes + length > _maxBytes);
+}
+
+// Append the specified entry.
+void Arena::push(std::string_view entry) {
+	size_t offset = place(entry.size());
+	if(offset == npos) {
+		reallocate(std::min(_maxBytes, std::max(_buffer.size() * 2,
+		                                        _bytes + entry.size())));
+		offset = _bytes;
+	}
+	if(!entry.empty()) {
+		std::memcpy(_buffer.data() + offset, entry.data(), entry.size());
+	}
+	if(_size == _slots.size()) {
+		growSlots();
+	}
+	_slots[(_first + _size) % _slots.size()] = { offset, entry.size(), false };
+	_bytes += entry.size();
+	++_size;
+}
+
+// Remove the oldest entry.
+void Arena::pop() {
+	if(_slots[_first].removed) {
+		--_removed;
+		_removedBytes -= _slots[_first].length;
+	}
+	_bytes -= _slots[_first].length;
+	_first = (_first + 1) % _slots.size();
+	--_size;
+}
+
+// Mark the entry at index i as removed.
+void Arena::remove(size_t i) {
+	Slot &slot = _slots[(_first + i) % _slots.size()];
+	if(!slot.removed) {
+		slot.removed = true;
+		++_removed;
+		_removedBytes += slot.length;
+	}
+}
+
+// Remove all entries.
+void Arena::clear() {
+	_bytes = 0;
+	_first = 0;
+	_size = 0;
+	_removed = 0;
+	_removedBytes = 0;
+}
+
+// Reclaim the storage of all entries marked as removed.
+void Arena::compact() {
+	if(!_removed) {
+		return;
+	}
+	
+	// Slide the remaining entries backward in circular order, keeping the
+	// oldest in place. Entries are never split, so one that no longer fits
+	// before the end of the buffer wraps around to its start, which only
+	// holds bytes preceding it in circular order.
+	size_t end = npos;
+	size_t size = 0;
+	for(size_t i = 0; i < _size; ++i) {
+		Slot slot = _slots[(_first + i) % _slots.size()];
+		if(slot.removed) {
+			continue;
+		}
+		if(end != npos) {
+			size_t offset = end + slot.length <= _buffer.size() ? end : 0;
+			if(slot.length && offset != slot.offset) {
+				std::memmove(_buffer.data() + offset,
+				             _buffer.data() + slot.offset, slot.length);
+			}
+			slot.offset = offset;
+		}
+		end = slot.offset + slot.length;
+		_slots[(_first + size++) % _slots.size()] = slot;
+	}
+	
+	_bytes -= _removedBytes;
+	_size = size;
+	_removed = 0;
+	_removedBytes = 0;
+}
+
+// Limit the number of bytes.
+void Arena::setMaxBytes(size_t maxBytes) {
+	_maxBytes = maxBytes;
+	if(_buffer.size() > _maxBytes) {
+		reallocate(_maxBytes);
+	}
+}
+
+// Retrieve the offset at which an entry of the specified length can be placed.
+size_t Arena::place(size_t length) const {
+	if(!_size) {
+		return length <= _buffer.size() ? 0 : npos;
+	}
+	
+	Slot const &oldest = _slots[_first];
+	Slot const &newest = _slots[(_first + _size - 1) % _slots.size()];
+	size_t begin = oldest.offset;
+	size_t end = newest.offset + newest.length;
+	if(begin < end || (begin == end && !_bytes)) {
+		// Used bytes are contiguous, so append or wrap around to the start.
+		if(_buffer.size() - end >= length) {
+			return end;
+		} else if(begin >= length) {
+			return 0;
+		}
+	} else if(begin - end >= length) {
+		// Used bytes wrap around, so fill the gap in between.
+		return end;
+	}
+	return npos;
+}
+
+// Reallocate the buffer with the specified capacity.
+void Arena::reallocate(size_t capacity) {
+	std::vector<char> buffer(capacity);
+	size_t offset = 0;
+	for(size_t i = 0; i < _size; ++i) {
+		Slot &slot = _slots[(_first + i) % _slots.size()];
+		if(slot.length) {
+			std::memcpy(buffer.data() + offset, _buffer.data() + slot.offset,
+			            slot.length);
+		}
+		slot.offset = offset;
+		offset += slot.length;
+	}
+	_buffer.swap(buffer);
+}
+
+// Grow the circular index of entries, keeping their indices.
+void Arena::growSlots() {
+	std::vector<Slot> slots(std::max<size_t>(_slots.size() * 2, 1));
+	for(size_t i = 0; i < _size; ++i) {
+		slots[i] = _slots[(_first + i) % _slots.size()];
+	}
+	_slots.swap(slots);
+	_first = 0;
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
@@ -0,0 +1,109 @@
+#ifndef CONSOLE_ARENA_H
+#define CONSOLE_ARENA_H
+
+#include <string_view>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                               Class Arena                                --
+//------------------------------------------------------------------------------
+// Circular queue of strings, storing their bytes contiguously in a single
+// circular byte buffer with a compact offset and length index. Once the
+// buffer has grown to fit the working set, pushing never allocates.
+class Arena {
+public:
+	// Construct an arena holding at most maxEntries entries and maxBytes bytes.
+	Arena(size_t maxEntries, size_t maxBytes);
+	
+	// Check if the arena is empty.
+	bool empty() const { return !_size; }
+	// Retrieve the number of entries.
+	size_t size() const { return _size; }
+	// Retrieve the maximum number of entries, not counting removed ones.
+	size_t maxEntries() const { return _maxEntries; }
+	// Retrieve the number of bytes used by entries.
+	size_t bytes() const { return _bytes; }
+	// Retrieve the number of bytes allocated for entries.
+	size_t capacity() const { return _buffer.size(); }
+	// Retrieve the number of entries marked as removed.
+	size_t removed() const { return _removed; }
+	// Retrieve the number of bytes used by entries marked as removed.
+	size_t removedBytes() const { return _removedBytes; }
+	
+	// Retrieve the entry at index i, counting from the oldest entry.
+	std::string_view operator[](size_t i) const {
+		Slot const &slot = _slots[(_first + i) % _slots.size()];
+		return { _buffer.data() + slot.offset, slot.length };
+	}
+	// Check if the entry at index i has been marked as removed.
+	bool removed(size_t i) const {
+		return _slots[(_first + i) % _slots.size()].removed;
+	}
+	// Retrieve the oldest and newest entries.
+	std::string_view front() const { return (*this)[0]; }
+	std::string_view back() const { return (*this)[_size - 1]; }
+	
+	// Check if the oldest entry must be removed before pushing an entry of the
+	// specified length. Entries marked as removed do not count toward the
+	// maximum number of entries, but their bytes do until they are reclaimed.
+	bool full(size_t length) const;
+	// Check if an entry of the specified length can be stored at all.
+	bool fits(size_t length) const { return length <= _maxBytes; }
+	
+	// Append the specified entry, which must not require removing entries.
+	void push(std::string_view entry);
+	// Remove the oldest entry.
+	void pop();
+	// Mark the entry at index i as removed. Its storage is reclaimed once it
+	// becomes the oldest entry, or by compact.
+	void remove(size_t i);
+	// Remove all entries.
+	void clear();
+	// Reclaim the storage of all entries marked as removed within the buffer,
+	// shifting the indices of the remaining entries.
+	void compact();
+	
+	// Limit the number of bytes, which must not be less than bytes().
+	void setMaxBytes(size_t maxBytes);
+	
+private:
+	// Retrieve the offset at which an entry of the specified length can be
+	// placed without growing the buffer, or npos if there is none.
+	size_t place(size_t length) const;
+	// Reallocate the buffer with the specified capacity, storing all entries
+	// contiguously from its start.
+	void reallocate(size_t capacity);
+	// Grow the circular index of entries, keeping their indices.
+	void growSlots();
+	
+private:
+	static size_t constexpr npos = size_t(-1);
+	
+	struct Slot {
+		size_t offset;
+		size_t length;
+		bool removed;
+	};
+	
+	// Circular byte buffer holding the entries.
+	std::vector<char> _buffer;
+	size_t _maxBytes;
+	size_t _bytes;
+	// Circular index of entries, holding removed entries beyond the maximum.
+	std::vector<Slot> _slots;
+	size_t _maxEntries;
+	size_t _first;
+	size_t _size;
+	size_t _removed;
+	size_t _removedBytes;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
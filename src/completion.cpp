@@ -0,0 +1,99 @@
+#include "completion.h"
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                            Class Completion                              --
+//------------------------------------------------------------------------------
+
+Completion::Completion(std::string line, size_t begin, size_t end,
+                       std::function<void()> notify)
+: _line(std::move(line))
+, _begin(begin)
+, _end(end)
+, _vocabulary(nullptr)
+, _cancelled(false)
+, _finished(false)
+, _notify(std::move(notify)) { }
+
+// Add a candidate.
+void Completion::add(std::string_view candidate) {
+	if(!finished()) {
+		_candidates.insert(candidate);
+	}
+}
+
+// Add the words of vocabulary starting with the word being completed.
+void Completion::add(Trie const &vocabulary) {
+	if(finished()) {
+		return;
+	}
+	// Only one vocabulary is referenced, copy any previous one.
+	if(_vocabulary != &vocabulary) {
+		mergeVocabulary();
+	}
+	_vocabulary = &vocabulary;
+}
+
+// Finish the request.
+void Completion::finish() {
+	// Copy the vocabulary if candidates were also added individually.
+	if(!_candidates.empty()) {
+		mergeVocabulary();
+	}
+	
+	std::lock_guard<std::mutex> lock(_mutex);
+	if(_finished.exchange(true, std::memory_order_acq_rel)) {
+		return;
+	}
+	if(_notify) {
+		_notify();
+	}
+}
+
+// Cancel the request, discarding its notification.
+void Completion::cancel() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_cancelled.store(true, std::memory_order_relaxed);
+	_notify = nullptr;
+}
+
+// Retrieve the number of candidates of a finished request.
+size_t Completion::count() const {
+	return _vocabulary ? _vocabulary->count(word()) : _candidates.size();
+}
+
+// Retrieve the longest common prefix of the candidates.
+std::string Completion::commonPrefix() const {
+	return _vocabulary ? _vocabulary->commonPrefix(word())
+	                   : _candidates.commonPrefix(std::string_view());
+}
+
+// Append up to limit candidates to candidates in byte order.
+void Completion::list(size_t offset, size_t limit,
+                      std::vector<std::string> &candidates) const {
+	if(_vocabulary) {
+		_vocabulary->list(word(), offset, limit, candidates);
+	} else {
+		_candidates.list(std::string_view(), offset, limit, candidates);
+	}
+}
+
+// Copy the candidates of the vocabulary to the individual candidates.
+void Completion::mergeVocabulary() {
+	if(!_vocabulary) {
+		return;
+	}
+	std::vector<std::string> candidates;
+	_vocabulary->list(word(), 0, _vocabulary->count(word()), candidates);
+	for(std::string const &candidate : candidates) {
+		_candidates.insert(candidate);
+	}
+	_vocabulary = nullptr;
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
@@ -0,0 +1,90 @@
+#ifndef CONSOLE_COMPLETION_H
+#define CONSOLE_COMPLETION_H
+
+#include "trie.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                            Class Completion                              --
+//------------------------------------------------------------------------------
+// Request to complete the word before the cursor. Candidates replace the word.
+// A provider adds candidates and finishes the request, either immediately or
+// later from another thread; further input cancels a pending request.
+class Completion {
+	// Not copyable nor assignable.
+	Completion(Completion const &) = delete;
+	Completion &operator=(Completion const &) = delete;
+	
+public:
+	// Construct a request for the word in [begin, end) of line. The notify
+	// function is called from the finishing thread.
+	Completion(std::string line, size_t begin, size_t end,
+	           std::function<void()> notify);
+	
+	// Retrieve the command line at the time of the request.
+	std::string const &line() const { return _line; }
+	// Retrieve the word being completed.
+	std::string_view word() const {
+		return std::string_view(_line).substr(_begin, _end - _begin);
+	}
+	
+	// Add a candidate.
+	void add(std::string_view candidate);
+	// Add the words of vocabulary starting with the word being completed.
+	// The vocabulary is not copied and must outlive the request.
+	void add(Trie const &vocabulary);
+	// Finish the request. May be called from any thread.
+	void finish();
+	
+	// Check if the request has been cancelled by further input.
+	bool cancelled() const { return _cancelled.load(std::memory_order_relaxed); }
+	// Check if the request has been finished.
+	bool finished() const { return _finished.load(std::memory_order_acquire); }
+	// Cancel the request, discarding its notification.
+	void cancel();
+	
+	// Retrieve the number of candidates of a finished request.
+	size_t count() const;
+	// Retrieve the longest common prefix of the candidates.
+	std::string commonPrefix() const;
+	// Append up to limit candidates to candidates in byte order, skipping the
+	// first offset of them.
+	void list(size_t offset, size_t limit,
+	          std::vector<std::string> &candidates) const;
+	
+private:
+	// Copy the candidates of the vocabulary to the individual candidates.
+	void mergeVocabulary();
+	
+private:
+	std::string _line;
+	size_t _begin;
+	size_t _end;
+	
+	// Candidates added individually.
+	Trie _candidates;
+	// Vocabulary holding the remaining candidates.
+	Trie const *_vocabulary;
+	
+	std::atomic<bool> _cancelled;
+	std::atomic<bool> _finished;
+	// Guards the notification against concurrent cancellation.
+	std::mutex _mutex;
+	std::function<void()> _notify;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -1,17 +1,24 @@
 #include "console.h"
+#include "csi.h"
+#include "utf8.h"
+#include "width.h"
 
 #if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
 #	include <windows.h>
 #	include <fcntl.h>
 #	include <io.h>
 #else
+#	include <fcntl.h>
+#	include <poll.h>
 #	include <termios.h>
 #	include <unistd.h>
 #endif
 
-#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <stdexcept>
-#include <vector>
+#include <system_error>
 
 //------------------------------------------------------------------------------
 //                          Begin namespace Console                           //
@@ -22,339 +29,521 @@ namespace Console {
 namespace {
 
 //------------------------------------------------------------------------------
-//--                           Raw Mode RAII Class                            --
+//--                          UTF-8 Repair Function                           --
 //------------------------------------------------------------------------------
-#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
-	class RawMode {
-	public:
-		RawMode() {
-			int fdIn = _fileno(stdin);
-			_setmode(fdIn, _O_BINARY);
-			
-			int fdOut = _fileno(stdout);
-			_setmode(fdOut, _O_BINARY);
-			
-			_atty = _isatty(fdIn);
-			if(_atty) {
-				_stdin = (HANDLE)_get_osfhandle(fdIn);
-				if(_stdin == INVALID_HANDLE_VALUE) {
-					throw std::runtime_error(
-						"Could not query terminal input."
-					);
-				}
-				_stdout = (HANDLE)_get_osfhandle(fdOut);
-				if(_stdout == INVALID_HANDLE_VALUE) {
-					throw std::runtime_error(
-						"Could not query terminal output."
-					);
-				}
-				
-				if(!GetConsoleMode(_stdin, &_stdinMode)) {
-					throw std::runtime_error(
-						"Could not query terminal input mode."
-					);
-				}
-				if(!GetConsoleMode(_stdout, &_stdoutMode)) {
-					throw std::runtime_error(
-						"Could not query terminal output mode."
-					);
-				}
-				
-				if(!SetConsoleMode(_stdin, ENABLE_VIRTUAL_TERMINAL_INPUT)) {
-					throw std::runtime_error(
-						"Could not enable raw mode on terminal input."
-					);
-				}
-				if(!SetConsoleMode(_stdout, ENABLE_VIRTUAL_TERMINAL_PROCESSING |
-				                            ENABLE_PROCESSED_OUTPUT)) {
-					throw std::runtime_error(
-						"Could not enable raw mode on terminal output."
-					);
-				}
-			} else {
-				if(system("stty raw -echo opost")) {
-					throw std::runtime_error(
-						"Could not enable raw mode on terminal."
-					);
-				}
-			}
-		}
-		
-		~RawMode() {
-			if(_atty) {
-				SetConsoleMode(_stdin, _stdinMode);
-				SetConsoleMode(_stdout, _stdoutMode);
-			} else {
-				system("stty sane");
-			}
-		}
-		
-	private:
-		HANDLE _stdin;
-		HANDLE _stdout;
-		DWORD _stdinMode;
-		DWORD _stdoutMode;
-		bool _atty;
-	};
-#else
-	class RawMode {
-	public:
-		RawMode() {
-			_atty = isatty(STDIN_FILENO);
-			if(_atty) {
-				if(tcgetattr(STDIN_FILENO, &_termIos) == -1) {
-					throw std::runtime_error(
-						"Could not query terminal."
-					);
-				}
-				
-				termios raw = _termIos;
-				
-				// cfmakeraw(&raw), but allow output post-processing for sane
-				// new-lines.
-				raw.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR |
-				                  IGNCR |ICRNL | IXON);
-				raw.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
-				raw.c_cflag &= ~(CSIZE | PARENB);
-				raw.c_cflag |= CS8;
-				
-				// Put terminal into raw mode after flushing.
-				if(tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) < 0) {
-					throw std::runtime_error(
-						"Could not enable raw mode on terminal."
-					);
-				}
-			}
-		}
-		
-		~RawMode() {
-			// Restore original terminal settings.
-			if(_atty) {
-				tcsetattr(STDIN_FILENO, TCSAFLUSH, &_termIos);
-			}
+// Replace every malformed utf8 sequence of the specified text with U+FFFD.
+std::string repairUtf8(std::string_view text) {
+	std::string result;
+	result.reserve(text.size());
+	for(size_t pos = 0; pos < text.size();) {
+		size_t n = Utf8::countOctets(text, pos);
+		if(n && pos + n <= text.size() && Utf8::valid(text.data() + pos, n)) {
+			result.append(text, pos, n);
+			pos += n;
+		} else {
+			result += "\xef\xbf\xbd";
+			++pos;
 		}
-		
-	private:
-		struct termios _termIos;
-		bool _atty;
-	};
-#endif
+	}
+	return result;
+}
+
+}
+//                      End namespace <helper functions>                      //
+//------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-//--                           CSI Escape Sequences                           --
+//--                              Class RawMode                               --
 //------------------------------------------------------------------------------
-namespace CSI {
-	// Graphic parameters.
-	auto constexpr resetAttributes = "\033[0m";
-	auto constexpr bright = "\033[1m";
-	
-	// Foreground colors.
-	auto constexpr black = "\033[30m";
-	auto constexpr red = "\033[31m";
-	auto constexpr green = "\033[32m";
-	auto constexpr yellow = "\033[33m";
-	auto constexpr blue = "\033[34m";
-	auto constexpr magenta = "\033[35m";
-	auto constexpr cyan = "\033[36m";
-	auto constexpr white = "\033[37m";
-	
-	// Background colors.
-	auto constexpr bgBlack = "\033[40m";
-	auto constexpr bgRed = "\033[41m";
-	auto constexpr bgGreen = "\033[42m";
-	auto constexpr bgYellow = "\033[43m";
-	auto constexpr bgBlue = "\033[44m";
-	auto constexpr bgMagenta = "\033[45m";
-	auto constexpr bgCyan = "\033[46m";
-	auto constexpr bgWhite = "\033[47m";
-	
-	// Display refresh.
-	auto constexpr clear = "\033[2K\r";
-	
-	// Cursor movement.
-	auto constexpr up = "\033[A";
-	auto constexpr down = "\033[B";
-	auto constexpr right = "\033[C";
-	auto constexpr left = "\033[D";
-	
-	// Stream manipulators for cursor movement.
-	class leftN {
-	public:
-		leftN(size_t n) : _n(n) { }
-		
-		friend std::ostream &operator<<(std::ostream &os, leftN const &left) {
-			if(left._n > 0) {
-				os << "\033[" << std::dec << left._n << "D";
-			}
-			return os;
-		}
-		
-	private:
-		size_t _n;
-	};
-	
-	// Retrieve key code corresponding to an escape sequence.
-	enum Key {
-		INVALID,
-		INCOMPLETE,
-		
-		UP_ARROW,
-		DOWN_ARROW,
-		RIGHT_ARROW,
-		LEFT_ARROW,
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+class Console::RawMode {
+public:
+	explicit RawMode(int input) {
+		_setmode(input, _O_BINARY);
 		
-		SHIFT_UP_ARROW,
-		SHIFT_DOWN_ARROW,
-		SHIFT_RIGHT_ARROW,
-		SHIFT_LEFT_ARROW,
+		int fdOut = _fileno(stdout);
+		_setmode(fdOut, _O_BINARY);
 		
-		HOME,
-		END,
-		INSERT,
-		DEL,
-		PAGE_UP,
-		PAGE_DOWN
-	};
-	Key getKey(std::string const &str) {
-		static std::vector<std::pair<std::string, Key>> keyMap {
-			{"\033[A", Key::UP_ARROW},
-			{"\033[B", Key::DOWN_ARROW},
-			{"\033[C", Key::RIGHT_ARROW},
-			{"\033[D", Key::LEFT_ARROW},
-			
-			{"\033OA", Key::SHIFT_UP_ARROW},
-			{"\033OB", Key::SHIFT_DOWN_ARROW},
-			{"\033OC", Key::SHIFT_RIGHT_ARROW},
-			{"\033OD", Key::SHIFT_LEFT_ARROW},
-			{"\033OF", Key::END},
-			{"\033OH", Key::HOME},
-			
-			{"\033[F", Key::END},
-			{"\033[H", Key::HOME},
+		_atty = _isatty(input);
+		if(_atty) {
+			_stdin = (HANDLE)_get_osfhandle(input);
+			if(_stdin == INVALID_HANDLE_VALUE) {
+				throw std::runtime_error(
+					"Could not query terminal input."
+				);
+			}
+			_stdout = (HANDLE)_get_osfhandle(fdOut);
+			if(_stdout == INVALID_HANDLE_VALUE) {
+				throw std::runtime_error(
+					"Could not query terminal output."
+				);
+			}
 			
-			{"\033[1;5A", Key::SHIFT_UP_ARROW},
-			{"\033[1;5B", Key::SHIFT_DOWN_ARROW},
-			{"\033[1;5C", Key::SHIFT_RIGHT_ARROW},
-			{"\033[1;5D", Key::SHIFT_LEFT_ARROW},
+			if(!GetConsoleMode(_stdin, &_stdinMode)) {
+				throw std::runtime_error(
+					"Could not query terminal input mode."
+				);
+			}
+			if(!GetConsoleMode(_stdout, &_stdoutMode)) {
+				throw std::runtime_error(
+					"Could not query terminal output mode."
+				);
+			}
 			
-			{"\033[1~", Key::HOME},
-			{"\033[2~", Key::INSERT},
-			{"\033[3~", Key::DEL},
-			{"\033[4~", Key::END},
-			{"\033[5~", Key::PAGE_UP},
-			{"\033[6~", Key::PAGE_DOWN}
-		};
-		Key key = Key::INVALID;
-		for(auto &pair : keyMap) {
-			if(pair.first.find(str) == 0) {
-				if(str.size() == pair.first.size()) {
-					return pair.second;
-				} else {
-					key = Key::INCOMPLETE;
-				}
+			if(!SetConsoleMode(_stdin, ENABLE_VIRTUAL_TERMINAL_INPUT)) {
+				throw std::runtime_error(
+					"Could not enable raw mode on terminal input."
+				);
+			}
+			if(!SetConsoleMode(_stdout, ENABLE_VIRTUAL_TERMINAL_PROCESSING |
+			                            ENABLE_PROCESSED_OUTPUT)) {
+				throw std::runtime_error(
+					"Could not enable raw mode on terminal output."
+				);
+			}
+		} else {
+			if(system("stty raw -echo opost")) {
+				throw std::runtime_error(
+					"Could not enable raw mode on terminal."
+				);
 			}
 		}
-		return key;
 	}
-}
-
-//------------------------------------------------------------------------------
-//--                          UTF-8 Helper Functions                          --
-//------------------------------------------------------------------------------
-namespace Utf8 {
-	// Count number of utf8 octets at position.
-	size_t countOctets(std::string const &str, size_t pos) {
-		uint8_t masked = uint8_t(str[pos]) & 0xff;
-		if(masked < 0x80) {
-			return 1;
-		} else if ((masked >> 5) == 0x6) {
-			return 2;
-		} else if ((masked >> 4) == 0xe) {
-			return 3;
-		} else if ((masked >> 3) == 0x1e) {
-			return 4;
+	
+	~RawMode() {
+		if(_atty) {
+			SetConsoleMode(_stdin, _stdinMode);
+			SetConsoleMode(_stdout, _stdoutMode);
 		} else {
-			return 0;
+			system("stty sane");
 		}
 	}
 	
-	// Previous utf8 starting position.
-	size_t posPrev(std::string const &str, size_t pos) {
-		if(pos) {
-			while((str[--pos] & 0xc0) == 0x80) {
-				if(pos == 0) {
-					break;
-				}
+private:
+	HANDLE _stdin;
+	HANDLE _stdout;
+	DWORD _stdinMode;
+	DWORD _stdoutMode;
+	bool _atty;
+};
+#else
+class Console::RawMode {
+public:
+	explicit RawMode(int input)
+	: _input(input) {
+		_atty = isatty(input);
+		if(_atty) {
+			if(tcgetattr(input, &_termIos) == -1) {
+				throw std::runtime_error(
+					"Could not query terminal."
+				);
+			}
+			
+			termios raw = _termIos;
+			
+			// cfmakeraw(&raw), but allow output post-processing for sane
+			// new-lines.
+			raw.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR |
+			                  IGNCR |ICRNL | IXON);
+			raw.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+			raw.c_cflag &= ~(CSIZE | PARENB);
+			raw.c_cflag |= CS8;
+			
+			// Put terminal into raw mode after flushing.
+			if(tcsetattr(input, TCSAFLUSH, &raw) < 0) {
+				throw std::runtime_error(
+					"Could not enable raw mode on terminal."
+				);
 			}
 		}
-		return pos;
 	}
 	
-	// Next utf8 starting position.
-	size_t posNext(std::string const &str, size_t pos) {
-		if(pos < str.size()) {
-			pos += countOctets(str, pos);
-			if(pos > str.size()) {
-				pos = str.size();
-			}
+	~RawMode() {
+		// Restore original terminal settings.
+		if(_atty) {
+			tcsetattr(_input, TCSAFLUSH, &_termIos);
 		}
-		return pos;
 	}
 	
-	// Count number of utf8 octets in string, starting at pos.
-	size_t count(std::string const &str, size_t pos = 0) {
-		size_t n = 0;
-		for(; pos < str.size(); pos = posNext(str, pos), ++n);
-		return n;
-	}
-}
-
-}
-//                      End namespace <helper functions>                      //
-//------------------------------------------------------------------------------
+private:
+	int _input;
+	struct termios _termIos;
+	bool _atty;
+};
+#endif
 
 //------------------------------------------------------------------------------
 //--                              Class Console                               --
 //------------------------------------------------------------------------------
 
 // Construct a console with the specified maximum history size.
-Console::Console(size_t historySize)
-: _history(historySize)
+Console::Console(size_t historySize, Output &output, int input, bool rawMode)
+: Console(std::make_shared<History>(historySize), output, input, rawMode) { }
+
+// Construct a console browsing and extending the specified history.
+Console::Console(std::shared_ptr<History> history, Output &output, int input,
+                 bool rawMode)
+: _history(std::move(history))
+, _input(input)
+, _output(&output)
+, _messages(nullptr)
+, _messageFds{-1, -1}
 , _prompt(": ")
+, _displayLine(false)
 , _cursor(0)
+, _pastePolicy(PastePolicy::JOIN)
+, _pasting(false)
+, _pasteMatched(0)
+, _batch(false)
 , _showPrompt(true)
 , _search(false)
+, _completing(false)
+, _completionOffset(0)
+, _completionPageSize(100)
+, _dirty(false)
+, _renderedBytes(0)
 , _prev(0) {
-	// Start console.
-	static RawMode raw;
+	// Start console, running non-interactively if the input is not a terminal.
+	if(rawMode) {
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+		_batch = !_isatty(_input);
+#else
+		_batch = !isatty(_input);
+#endif
+		if(!_batch) {
+			_rawMode.reset(new RawMode(_input));
+		}
+	}
 	
-	// Print prompt.
-	refresh();
+#if !(defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64))
+	// Create pipe for signalling printed messages.
+	// Report the error code, so running out of descriptors can be told apart.
+	if(pipe(_messageFds) == -1 ||
+	   fcntl(_messageFds[0], F_SETFL, O_NONBLOCK) == -1 ||
+	   fcntl(_messageFds[1], F_SETFL, O_NONBLOCK) == -1) {
+		int error = errno;
+		if(_messageFds[0] != -1) {
+			close(_messageFds[0]);
+			close(_messageFds[1]);
+		}
+		throw std::system_error(
+			error, std::generic_category(),
+			"Could not create message pipe."
+		);
+	}
+#endif
+	
+	// Enable bracketed paste and print prompt.
+	_frame.reserve(4096);
+	if(_batch) {
+		_showPrompt = false;
+	} else {
+		_frame += CSI::enablePaste;
+		refresh();
+		flush();
+	}
+	
+	// Count metrics from the first input on, leaving those of a history shared
+	// with other consoles intact.
+	CONSOLE_METRIC(_metrics = ConsoleMetrics();)
+	CONSOLE_METRIC(_capacity = _frame.capacity() + _display.capacity() +
+	                           _commandLine.capacity();)
+}
+
+Console::~Console() {
+	_history->detach(_session);
+	
+	// Restore the terminal's paste mode, ignoring a closed output.
+	if(!_batch) {
+		try {
+			_output->write(CSI::disablePaste, std::strlen(CSI::disablePaste));
+		} catch(std::exception const &) { }
+	}
+	
+	// Detach a completion still running on another thread.
+	if(_completion) {
+		_completion->cancel();
+	}
+	
+	// Discard unprinted messages.
+	for(Message *message = _messages.exchange(nullptr); message;) {
+		Message *next = message->next;
+		delete message;
+		message = next;
+	}
+	
+#if !(defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64))
+	close(_messageFds[0]);
+	close(_messageFds[1]);
+#endif
 }
 
 // Set the command prompt.
 void Console::setPrompt(std::string prompt) {
 	_prompt = std::move(prompt);
+	_displayLine = false;
 	refresh();
+	flush();
 }
 
 // Load the command history from the specified file.
 void Console::loadHistory(std::string const &path, bool homeDir) {
-	_history.load(path, homeDir);
+	history().load(path, homeDir);
 }
 
 // Save the command history to the specified file.
 void Console::saveHistory(std::string const &path, bool homeDir) const {
-	_history.save(path, homeDir);
+	_history->save(path, homeDir);
+}
+
+// Append all subsequently added commands to the specified history file.
+void Console::journalHistory(std::string const &path, bool homeDir) {
+	history().journal(path, homeDir);
+}
+
+// Write and sync the journaled commands, waiting for completion.
+void Console::syncHistory() {
+	history().sync();
+}
+
+// Share the command history with concurrent processes.
+void Console::shareHistory(std::string const &path, bool homeDir) {
+	history().share(path, homeDir);
 }
 
 // Add the specified string to the end of the history.
 void Console::addHistory(std::string command) {
-	_history.push(std::move(command));
+	history().push(std::move(command));
 }
 
 // Push a character of input to the console.
 bool Console::putc(char c) {
+	return feed(&c, 1);
+}
+
+// Push a chunk of input to the console, refreshing the display only once.
+bool Console::feed(char const *data, size_t size) {
+	CONSOLE_METRIC(ScopedTimer timer(_metrics.inputTime);)
+	CONSOLE_METRIC(++_metrics.inputs;)
+	CONSOLE_METRIC(_metrics.inputBytes += size;)
+	size_t rendered = _renderer.totalBytes();
+	
+	// Bypass the line editor in batch mode.
+	if(_batch) {
+		enterLines(data, size);
+		flush();
+		flushMessages();
+		_renderedBytes = 0;
+		CONSOLE_METRIC(countAllocations();)
+		return true;
+	}
+	
+	for(size_t i = 0; i < size;) {
+		// Take pasted text in bulk instead of as keys.
+		if(_pasting) {
+			i += paste(data + i, size - i);
+		} else if(!process(data[i++])) {
+			flush();
+			_renderedBytes = _renderer.totalBytes() - rendered;
+			CONSOLE_METRIC(countAllocations();)
+			return false;
+		}
+	}
+	update();
+	flush();
+	flushMessages();
+	
+	_renderedBytes = _renderer.totalBytes() - rendered;
+	CONSOLE_METRIC(countAllocations();)
+	return true;
+}
+
+// Enter the final line of input in batch mode even if it is incomplete.
+void Console::finishInput() {
+	if(!_batchLine.empty()) {
+		std::string line;
+		line.swap(_batchLine);
+		enterLine(line);
+		flush();
+		flushMessages();
+	}
+}
+
+// Enable or disable batch mode.
+void Console::setBatch(bool batch) {
+	if(batch == _batch) {
+		return;
+	}
+	if(batch) {
+		// Remove the command prompt from the terminal.
+		if(_showPrompt) {
+			_renderer.clear(_frame);
+			_showPrompt = false;
+		}
+		_frame += CSI::disablePaste;
+	} else {
+		finishInput();
+		_frame += CSI::enablePaste;
+		_showPrompt = true;
+		_renderer.invalidate();
+		refresh();
+	}
+	_batch = batch;
+	flush();
+}
+
+// Print the specified message above the command prompt.
+void Console::print(std::string message) {
+	Message *node = new Message { std::move(message), nullptr };
+	Message *head = _messages.load(std::memory_order_relaxed);
+	do {
+		node->next = head;
+	} while(!_messages.compare_exchange_weak(head, node,
+	                                         std::memory_order_release,
+	                                         std::memory_order_relaxed));
+	
+#if !(defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64))
+	// Wake the console thread if the queue was empty. A full pipe already
+	// guarantees a pending wake-up, so the result can be ignored.
+	if(!head) {
+		char c = 0;
+		ssize_t n = write(_messageFds[1], &c, 1);
+		(void)n;
+	}
+#endif
+}
+
+// Write all pending printed messages, repainting the command prompt once.
+void Console::flushMessages() {
+#if !(defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64))
+	// Drain wake-up signals before taking the queue, so none are lost.
+	char buffer[64];
+	while(read(_messageFds[0], buffer, sizeof(buffer)) > 0);
+#endif
+	
+	// Apply a completion finished by another thread.
+	if(_completing && _completion->finished()) {
+		applyCompletion();
+		update();
+		flush();
+	}
+	
+	Message *message = _messages.exchange(nullptr, std::memory_order_acquire);
+	if(!message) {
+		return;
+	}
+	
+	// Reverse the stack into printing order.
+	Message *first = nullptr;
+	while(message) {
+		Message *next = message->next;
+		message->next = first;
+		first = message;
+		message = next;
+	}
+	
+	if(_showPrompt) {
+		_renderer.clear(_frame);
+	}
+	for(message = first; message;) {
+		_frame += message->text;
+		if(message->text.empty() || message->text.back() != '\n') {
+			_frame += '\n';
+		}
+		Message *next = message->next;
+		delete message;
+		message = next;
+	}
+	if(_showPrompt) {
+		refresh();
+	}
+	flush();
+}
+
+// Read and process the available input once the input is readable.
+bool Console::onReadable() {
+	char buffer[4096];
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+	// Non-blocking reads are not supported, so process a single chunk.
+	int n = _read(_input, buffer, sizeof(buffer));
+	if(n < 0) {
+		throw std::runtime_error(
+			"Could not read from input."
+		);
+	}
+	if(n == 0) {
+		finishInput();
+		return false;
+	}
+	return feed(buffer, n);
+#else
+	// Leave the file status flags alone, as the terminal's open file
+	// description is shared with the standard streams. Instead, read once per
+	// readiness and check for more input without waiting.
+	pollfd fd { _input, POLLIN, 0 };
+	do {
+		ssize_t n = read(_input, buffer, sizeof(buffer));
+		if(n > 0) {
+			if(!feed(buffer, n)) {
+				return false;
+			}
+		} else if(n == 0) {
+			// Input has been closed.
+			finishInput();
+			return false;
+		} else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			throw std::runtime_error(
+				"Could not read from input."
+			);
+		}
+	} while(::poll(&fd, 1, 0) > 0);
+	return true;
+#endif
+}
+
+// Wait up to timeout milliseconds for input and process it.
+bool Console::poll(int timeout) {
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+	HANDLE handle = (HANDLE)_get_osfhandle(_input);
+	if(handle == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error(
+			"Could not query input."
+		);
+	}
+	switch(WaitForSingleObject(handle, timeout < 0 ? INFINITE : timeout)) {
+	case WAIT_OBJECT_0:
+		return onReadable();
+	case WAIT_TIMEOUT:
+		flushMessages();
+		return true;
+	default:
+		throw std::runtime_error(
+			"Could not wait for input."
+		);
+	}
+#else
+	pollfd fds[] {
+		{ _input, POLLIN, 0 },
+		{ _messageFds[0], POLLIN, 0 }
+	};
+	int n = ::poll(fds, 2, timeout);
+	if(n < 0) {
+		if(errno == EINTR) {
+			return true;
+		}
+		throw std::runtime_error(
+			"Could not wait for input."
+		);
+	}
+	if(fds[1].revents) {
+		flushMessages();
+	}
+	return !fds[0].revents || onReadable();
+#endif
+}
+
+// Process a character of input without refreshing the display.
+bool Console::process(char c) {
 	static const char CTRL_C = 0x03;
 	static const char CTRL_D = 0x04;
 	static const char BS     = 0x08;
@@ -365,9 +554,16 @@ bool Console::putc(char c) {
 	static const char ESC    = 0x1B;
 	static const char DEL    = 0x7F;
 	
+	// Further input supersedes completion.
+	if(_completion && c != TAB) {
+		cancelCompletion();
+	}
+	
 	switch(c) {
 	case CTRL_C:
-		std::cout << "\r\n^C" << std::endl;
+		update();
+		_frame += "\r\n^C\n";
+		_renderer.invalidate();
 		if(_commandLine.empty() && !_search) {
 			_showPrompt = false;
 			return false;
@@ -375,62 +571,69 @@ bool Console::putc(char c) {
 			_cursor = 0;
 			_commandLine.clear();
 			_utf8Buffer.clear();
-			_escBuffer.clear();
-			_history.cancel();
+			_decoder.reset();
+			history().cancel();
 			_search = false;
-			refresh();
+			invalidate();
 		}
 		break;
 	case CTRL_D:
-		std::cout << "\r\n^D" << std::endl;
+		update();
+		_frame += "\r\n^D\n";
+		_renderer.invalidate();
 		_showPrompt = false;
 		return false;
 	case CTRL_R:
 		_utf8Buffer.clear();
-		_escBuffer.clear();
+		_decoder.reset();
 		if(_search) {
-			_history.backward(_commandLine);
+			history().backward(_commandLine.view());
 		} else {
 			_search = true;
-			_history.search(_commandLine);
+			history().merge();
+			history().search(std::string(_commandLine.view()));
 		}
-		refresh();
+		invalidate();
 		break;
 	case TAB:
 		_utf8Buffer.clear();
-		_escBuffer.clear();
+		_decoder.reset();
 		// Adopt search result.
 		if(_search) {
-			std::string const &result = _history.current();
+			std::string_view result = history().current();
 			if(!result.empty()) {
-				_commandLine = result;
+				_commandLine.assign(result);
 			}
 			_cursor = _commandLine.size();
-			_history.cancel();
+			history().cancel();
 			_search = false;
-			refresh();
+			invalidate();
 			break;
 		// Abort escaped search.
-		} else if(_history.searching()) {
-			_history.cancel();
+		} else if(history().searching()) {
+			history().cancel();
 		}
 		
-		// TODO: Autocompletion.
+		if(!_completion) {
+			complete();
+		} else if(!_completing) {
+			listCompletions();
+		}
 		break;
 	case DEL:
 	case BS: {
-		// Erase complete utf8 codepoint.
+		// Erase complete character.
 		size_t end = _cursor;
-		_cursor = Utf8::posPrev(_commandLine, _cursor);
+		_cursor = Width::posPrev(_commandLine, _cursor);
 		_commandLine.erase(_cursor, end - _cursor);
 		_utf8Buffer.clear();
-		_escBuffer.clear();
+		_decoder.reset();
 		if(_search) {
-			_history.search(_commandLine);
+			history().search(std::string(_commandLine.view()));
 		} else {
-			_history.cancel();
+			history().cancel();
 		}
-		refresh();
+		invalidate();
 		break; }
 	case LF:
 		if(_prev == CR) {
@@ -439,79 +642,83 @@ bool Console::putc(char c) {
 		goto CR; // [[fallthrough]]
 	case CR: CR: {
 		if(_search) {
-			std::string const &result = _history.current();
+			std::string_view result = history().current();
 			if(!result.empty()) {
-				_commandLine = result;
+				_commandLine.assign(result);
 			}
 			// Redisplay as non-search prompt.
 			_search = false;
-			refresh();
+			invalidate();
 		}
-		std::cout << std::endl;
+		update();
+		_frame += '\n';
+		_renderer.invalidate();
+		flush();
 		
 		if(!_commandLine.empty()) {
-			onCommand(std::move(_commandLine));
+			onCommand(std::string(_commandLine.view()));
 		}
 		
 		_cursor = 0;
 		_commandLine.clear();
 		_utf8Buffer.clear();
-		_escBuffer.clear();
-		_history.cancel();
+		_decoder.reset();
+		history().cancel();
 		_search = false;
-		refresh();
+		invalidate();
 		break; }
 	case ESC:
 		_utf8Buffer.clear();
-		_escBuffer = c;
+		_decoder.start();
 		// Cannot differentiate between ESC and an escape sequence, so
 		// deactivate the search temporarily.
 		if(_search) {
 			_search = false;
-			refresh();
+			invalidate();
 		// Cancel an already escaped search.
-		} else if(_history.searching()) {
-			_history.cancel();
+		} else if(history().searching()) {
+			history().cancel();
 		}
 		break;
 	default: {
-		bool escChar = !_escBuffer.empty();
+		bool escChar = _decoder.active();
 		if(escChar) {
-			_escBuffer.push_back(c);
-			CSI::Key key = CSI::getKey(_escBuffer);
+			CSI::Key key = _decoder.push(c);
+			CONSOLE_METRIC(_metrics.sequences += key != CSI::Key::INCOMPLETE;)
 			// Restore an escaped search with a valid escape sequence.
 			if(key != CSI::Key::INVALID) {
-				_search = _history.searching();
+				_search = history().searching();
 			}
 			switch(key) {
 			case CSI::Key::INCOMPLETE:
 				break;
 			case CSI::Key::UP_ARROW:
 				if(_search) {
-					_history.backward(_commandLine);
+					history().backward(_commandLine.view());
 				} else {
-					_commandLine = _history.backward(_commandLine);
+					history().merge();
+					_commandLine.assign(history().backward(_commandLine.view()));
 					_cursor = _commandLine.size();
 				}
 				break;
 			case CSI::Key::DOWN_ARROW:
 				if(_search) {
-					_history.forward(_commandLine);
+					history().forward(_commandLine.view());
 				} else {
-					_commandLine = _history.forward(_commandLine);
+					_commandLine.assign(history().forward(_commandLine.view()));
 					_cursor = _commandLine.size();
 				}
 				break;
 			case CSI::Key::LEFT_ARROW:
-				_cursor = Utf8::posPrev(_commandLine, _cursor);
+				_cursor = Width::posPrev(_commandLine, _cursor);
 				break;
 			case CSI::Key::RIGHT_ARROW:
-				_cursor = Utf8::posNext(_commandLine, _cursor);
+				_cursor = Width::posNext(_commandLine, _cursor);
 				break;
 			case CSI::Key::SHIFT_LEFT_ARROW:
-				_cursor = Utf8::posPrev(_commandLine, _cursor);
+				_cursor = Width::posPrev(_commandLine, _cursor);
 				while(_cursor) {
-					size_t pos = Utf8::posPrev(_commandLine, _cursor);
+					size_t pos = Width::posPrev(_commandLine, _cursor);
 					if(_commandLine[pos] == ' ') {
 						break;
 					}
@@ -519,7 +726,7 @@ bool Console::putc(char c) {
 				}
 				break;
 			case CSI::Key::SHIFT_RIGHT_ARROW:
-				while((_cursor = Utf8::posNext(_commandLine, _cursor))
+				while((_cursor = Width::posNext(_commandLine, _cursor))
 				      < _commandLine.size()) {
 					if(_commandLine[_cursor] == ' ') {
 						break;
@@ -533,46 +740,45 @@ bool Console::putc(char c) {
 				_cursor = _commandLine.size();
 				break;
 			case CSI::Key::DEL: {
-				// Erase complete utf8 codepoint.
-				size_t end = Utf8::posNext(_commandLine, _cursor);
+				// Erase complete character.
+				size_t end = Width::posNext(_commandLine, _cursor);
 				_commandLine.erase(_cursor, end - _cursor);
 				if(_search) {
-					_history.search(_commandLine);
+					history().search(std::string(_commandLine.view()));
 				} else {
-					_history.cancel();
+					history().cancel();
 				}
 				break; }
+			case CSI::Key::PASTE_BEGIN:
+				_pasting = true;
+				break;
+			case CSI::Key::PASTE_END:
+				break;
 			case CSI::Key::INVALID:
-				if(_history.searching() && !_search) {
+				if(history().searching() && !_search) {
 					escChar = false;
 					break;
 				}
 				goto DEFAULT; // [[fallthrough]]
 			default: DEFAULT:
-				std::cout << "\r\nUnknown escape sequence: ESC "
-				          << _escBuffer.substr(1) << std::endl;
+				update();
+				_frame += "\r\nUnknown escape sequence: ESC ";
+				_frame += _decoder.sequence();
+				_frame += '\n';
+				_renderer.invalidate();
 				break;
 			};
-			if(key != CSI::Key::INCOMPLETE) {
-				_escBuffer.clear();
-			}
 		}
 		if(!escChar) {
 			_utf8Buffer.push_back(c);
 			if(Utf8::countOctets(_utf8Buffer, 0) == _utf8Buffer.size()) {
 				// Insert or append character to command.
-				_commandLine.insert(_cursor, _utf8Buffer);
-				_cursor += _utf8Buffer.size();
+				insert(_utf8Buffer);
 				_utf8Buffer.clear();
-				if(_search) {
-					_history.search(_commandLine);
-				} else {
-					_history.cancel();
-				}
 			}
 		}
 		
-		refresh();
+		invalidate();
 		
 		break; }
 	}
@@ -580,39 +786,334 @@ bool Console::putc(char c) {
 	return true;
 }
 
+// Insert the specified text at the cursor.
+void Console::insert(std::string_view text) {
+	_commandLine.insert(_cursor, text);
+	_cursor += text.size();
+	if(_search) {
+		history().search(std::string(_commandLine.view()));
+	} else {
+		history().cancel();
+	}
+	invalidate();
+}
+
+// Enter every complete line of the specified input as a command.
+void Console::enterLines(char const *data, size_t size) {
+	char const *end = data + size;
+	while(char const *lf = (char const *)std::memchr(data, '\n', end - data)) {
+		if(_batchLine.empty()) {
+			enterLine(std::string_view(data, lf - data));
+		} else {
+			// Complete the line started by previous input.
+			std::string line;
+			line.swap(_batchLine);
+			line.append(data, lf);
+			enterLine(line);
+		}
+		data = lf + 1;
+	}
+	_batchLine.append(data, end);
+}
+
+// Enter the specified line as a command, unless it is empty.
+void Console::enterLine(std::string_view line) {
+	if(!line.empty() && line.back() == '\r') {
+		line.remove_suffix(1);
+	}
+	if(!line.empty()) {
+		onCommand(std::string(line));
+	}
+}
+
+// Collect pasted text up to the end of the paste.
+size_t Console::paste(char const *data, size_t size) {
+	std::string_view const end = CSI::pasteEnd;
+	size_t i = 0;
+	while(i < size) {
+		// Continue matching an end sequence, possibly split across chunks.
+		if(_pasteMatched) {
+			if(data[i] == end[_pasteMatched]) {
+				++i;
+				if(++_pasteMatched == end.size()) {
+					_pasteMatched = 0;
+					finishPaste();
+					return i;
+				}
+				continue;
+			}
+			// The matched bytes were pasted text after all.
+			_pasteBuffer.append(end.data(), _pasteMatched);
+			_pasteMatched = 0;
+		}
+		
+		// Copy all text up to the next escape character at once.
+		char const *esc = (char const *)std::memchr(data + i, end[0], size - i);
+		size_t n = esc ? size_t(esc - (data + i)) : size - i;
+		_pasteBuffer.append(data + i, n);
+		i += n;
+		if(esc) {
+			_pasteMatched = 1;
+			++i;
+		}
+	}
+	return i;
+}
+
+// Insert the collected pasted text according to the paste policy.
+void Console::finishPaste() {
+	_pasting = false;
+	std::string text;
+	text.swap(_pasteBuffer);
+	
+	// Normalize line breaks to LF and tabs to spaces, and drop other control
+	// characters.
+	size_t size = 0;
+	size_t lines = 0;
+	for(size_t i = 0; i < text.size(); ++i) {
+		char c = text[i];
+		if(c == '\r' || c == '\n') {
+			if(c == '\r' && i + 1 < text.size() && text[i + 1] == '\n') {
+				++i;
+			}
+			c = '\n';
+			++lines;
+		} else if(c == '\t') {
+			c = ' ';
+		} else if((unsigned char)c < 0x20 || c == 0x7f) {
+			continue;
+		}
+		text[size++] = c;
+	}
+	text.resize(size);
+	
+	// Replace malformed utf8, which cursor movement cannot step through,
+	// checking the usually well-formed text in bulk.
+	if(!Utf8::valid(text)) {
+		text = repairUtf8(text);
+	}
+	
+	if(_pastePolicy == PastePolicy::ENTER) {
+		size_t begin = 0;
+		for(size_t end; (end = text.find('\n', begin)) != std::string::npos;
+		    begin = end + 1) {
+			insert(std::string_view(text).substr(begin, end - begin));
+			process('\r');
+		}
+		insert(std::string_view(text).substr(begin));
+		// The synthetic carriage returns must not pair with a line feed
+		// following the paste.
+		_prev = 0;
+	} else {
+		while(!text.empty() && text.back() == '\n') {
+			text.pop_back();
+			--lines;
+		}
+		if(!lines) {
+			insert(text);
+		} else if(_pastePolicy == PastePolicy::JOIN) {
+			std::replace(text.begin(), text.end(), '\n', ' ');
+			insert(text);
+		} else {
+			_frame += '\a';
+		}
+	}
+	
+	// Keep the buffer for the next paste.
+	text.clear();
+	_pasteBuffer.swap(text);
+}
+
+// Complete from the vocabulary.
+void Console::onComplete(std::shared_ptr<Completion> completion) {
+	completion->add(_vocabulary);
+	completion->finish();
+}
+
+// Request completion of the word before the cursor.
+void Console::complete() {
+	size_t begin = _cursor;
+	while(begin && _commandLine[begin - 1] != ' ') {
+		--begin;
+	}
+	
+	std::function<void()> notify;
+#if !(defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64))
+	// Wake the console thread when finished by another thread.
+	notify = [fd = _messageFds[1]] {
+		char c = 0;
+		ssize_t n = write(fd, &c, 1);
+		(void)n;
+	};
+#endif
+	_completion = std::make_shared<Completion>(std::string(_commandLine.view()),
+	                                           begin, _cursor, std::move(notify));
+	_completing = true;
+	_completionOffset = 0;
+	onComplete(_completion);
+	if(_completion && _completion->finished()) {
+		applyCompletion();
+	}
+}
+
+// Apply the candidates of the finished completion request.
+void Console::applyCompletion() {
+	_completing = false;
+	size_t count = _completion->count();
+	std::string_view word = _completion->word();
+	std::string prefix = _completion->commonPrefix();
+	
+	if(count == 1) {
+		// Replace the word with the only candidate.
+		prefix += ' ';
+		_cursor -= word.size();
+		_commandLine.erase(_cursor, word.size());
+		_commandLine.insert(_cursor, prefix);
+		_cursor += prefix.size();
+	} else if(prefix.size() > word.size() && !prefix.compare(0, word.size(), word)) {
+		// Extend the word to the common prefix of the candidates.
+		_commandLine.insert(_cursor, std::string_view(prefix).substr(word.size()));
+		_cursor += prefix.size() - word.size();
+	}
+	if(count <= 1) {
+		_completion.reset();
+	}
+	history().cancel();
+	invalidate();
+}
+
+// List the next page of completion candidates above the command prompt.
+void Console::listCompletions() {
+	std::vector<std::string> candidates;
+	_completion->list(_completionOffset, _completionPageSize, candidates);
+	_completionOffset += candidates.size();
+	
+	// Arrange the candidates in columns across the terminal, assuming 80
+	// columns if its width is unknown.
+	size_t width = 0;
+	for(std::string const &candidate : candidates) {
+		width = std::max(width, Width::measure(candidate));
+	}
+	size_t terminalColumns = _output->columns();
+	if(!terminalColumns) {
+		terminalColumns = 80;
+	}
+	size_t columns = std::max<size_t>(1, terminalColumns / (width + 2));
+	
+	_renderer.clear(_frame);
+	for(size_t i = 0; i < candidates.size(); ++i) {
+		_frame += candidates[i];
+		if(i % columns == columns - 1 || i + 1 == candidates.size()) {
+			_frame += '\n';
+		} else {
+			_frame.append(width + 2 - Width::measure(candidates[i]), ' ');
+		}
+	}
+	size_t remaining = _completion->count() - _completionOffset;
+	if(remaining) {
+		_frame += "--More-- (" + std::to_string(remaining) + " remaining)\n";
+	} else {
+		// Start over on the next request.
+		_completionOffset = 0;
+	}
+	invalidate();
+}
+
+// Abandon the current completion request.
+void Console::cancelCompletion() {
+	_completion->cancel();
+	_completion.reset();
+	_completing = false;
+	_completionOffset = 0;
+}
+
 // Refresh the command prompt.
-void Console::refresh() const {
+void Console::refresh() {
+	CONSOLE_METRIC(ScopedTimer timer(_metrics.renderTime);)
+	CONSOLE_METRIC(++_metrics.renders;)
+	_dirty = false;
 	if(_showPrompt) {
 		// Prepare prompt line.
-		std::cout << CSI::clear << CSI::green;
-		
+		size_t cursor;
+		size_t unchanged = 0;
 		if(_search) {
-			std::cout << "history search : " << _commandLine;
+			_displayLine = false;
+			_display = "history search : ";
+			cursor = _display.size() + _cursor;
+			_commandLine.appendTo(_display);
 			
-			// Print search result.
-			std::string display = " -> ";
-			std::string const &result = _history.current();
+			// Append search result.
+			_display += " -> ";
+			std::string_view result = history().current();
 			if(result.empty()) {
-				display += "search failed";
+				_display += "search failed";
 			} else {
-				display += result;
+				_display += result;
 			}
-			std::cout << display;
-			
-			// Move cursor backwards to end of command line.
-			std::cout << CSI::leftN(Utf8::count(display));
 		} else {
-			std::cout << _prompt << _commandLine;
+			// Rebuild only the modified tail of the command line.
+			size_t dirty = 0;
+			if(_displayLine) {
+				dirty = _commandLine.dirty();
+				unchanged = _prompt.size() + dirty;
+				_display.resize(unchanged);
+			} else {
+				_display = _prompt;
+				_displayLine = true;
+			}
+			cursor = _prompt.size() + _cursor;
+			_commandLine.appendTo(_display, dirty);
 		}
+		_commandLine.clean();
 		
-		// Move cursor backwards to appropriate position.
-		std::cout << CSI::leftN(Utf8::count(_commandLine, _cursor));
-		
-		// Reset all attributes/color.
-		std::cout << CSI::resetAttributes << std::flush;
+		CONSOLE_METRIC(size_t rendered = _renderer.totalBytes();)
+		_renderer.render(_frame, _display, cursor, unchanged);
+		CONSOLE_METRIC(
+			_metrics.renderedBytes += _renderer.totalBytes() - rendered;
+		)
 	}
 }
 
+// Write the pending frame to the output.
+void Console::flush() {
+	if(!_frame.empty()) {
+		CONSOLE_METRIC(ScopedTimer timer(_metrics.writeTime);)
+		CONSOLE_METRIC(++_metrics.writes;)
+		CONSOLE_METRIC(_metrics.writtenBytes += _frame.size();)
+		_output->write(_frame.data(), _frame.size());
+		_frame.clear();
+	}
+}
+
+#if defined(CONSOLE_METRICS)
+// Count growths of the frame, display and command line buffers.
+void Console::countAllocations() {
+	size_t capacity = _frame.capacity() + _display.capacity() +
+	                  _commandLine.capacity();
+	_metrics.allocations += capacity > _capacity;
+	_capacity = capacity;
+}
+#endif
+
+// Retrieve a snapshot of the metrics of the console and its history.
+ConsoleMetrics Console::metrics() const {
+#if defined(CONSOLE_METRICS)
+	ConsoleMetrics metrics = _metrics;
+#else
+	ConsoleMetrics metrics;
+#endif
+	metrics.history = _history->metrics();
+	return metrics;
+}
+
+// Reset all metrics of the console and its history.
+void Console::resetMetrics() {
+	CONSOLE_METRIC(_metrics = ConsoleMetrics();)
+	CONSOLE_METRIC(_capacity = _frame.capacity() + _display.capacity() +
+	                           _commandLine.capacity();)
+	history().resetMetrics();
+}
+
 }
 //                           End namespace Console                            //
 //------------------------------------------------------------------------------
@@ -1,9 +1,18 @@
 #ifndef CONSOLE_CONSOLE_H
 #define CONSOLE_CONSOLE_H
 
+#include "completion.h"
+#include "csi.h"
 #include "history.h"
+#include "linebuffer.h"
+#include "metrics.h"
+#include "output.h"
+#include "renderer.h"
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <string_view>
 
 //------------------------------------------------------------------------------
 //                          Begin namespace Console                           //
@@ -18,11 +27,46 @@ class Console {
 	Console &operator=(Console const &) = delete;
 	
 public:
-	// Construct a console with the specified maximum command history size.
-	Console(size_t historySize = 256);
+	// Handling of pasted text spanning multiple lines. Tabs are pasted as
+	// spaces, other control characters are dropped and trailing line breaks
+	// are ignored unless entering the lines.
+	enum class PastePolicy {
+		// Join the lines with spaces.
+		JOIN,
+		// Enter every complete line as a command, leaving any remainder in the
+		// command line.
+		ENTER,
+		// Reject the text, ringing the bell.
+		REJECT
+	};
+	
+public:
+	// Construct a console with the specified maximum command history size,
+	// writing to the specified output and reading from the specified input file
+	// descriptor (standard input by default). Unless rawMode is false, the
+	// terminal of the input is put into raw mode until the console is
+	// destroyed; headless consoles, e.g. writing to a VirtualTerminal, leave it.
+	// With rawMode, a console whose input is not a terminal runs in batch mode.
+	Console(size_t historySize = 256, Output &output = standardOutput(),
+	        int input = 0, bool rawMode = true);
+	// Construct a console browsing and extending the specified history, which
+	// may be shared with other consoles run by the same thread.
+	Console(std::shared_ptr<History> history,
+	        Output &output = standardOutput(), int input = 0,
+	        bool rawMode = true);
+	virtual ~Console();
 	
 	// Set the command prompt.
 	void setPrompt(std::string prompt);
+	// Set the handling of pasted text spanning multiple lines.
+	void setPastePolicy(PastePolicy policy) { _pastePolicy = policy; }
+	
+	// Enable or disable batch mode, in which input is not edited but split
+	// into lines entered as commands, and neither the command prompt nor
+	// escape sequences are written. Printed messages are still written.
+	void setBatch(bool batch);
+	// Check if the console runs in batch mode.
+	bool batch() const { return _batch; }
 	
 	// Load the command history from the specified file.
 	// If homeDir is true, path is relative to the user's home directory.
@@ -30,40 +74,209 @@ public:
 	// Save the command history to the specified file.
 	// If homeDir is true, path is relative to the user's home directory.
 	void saveHistory(std::string const &path, bool homeDir = true) const;
+	// Append all subsequently added commands to the specified history file.
+	// If homeDir is true, path is relative to the user's home directory.
+	void journalHistory(std::string const &path, bool homeDir = true);
+	// Write and sync the journaled commands, waiting for completion.
+	// Throws if journaled commands could not be written since the previous
+	// sync or added command.
+	void syncHistory();
+	// Share the command history with concurrent processes through the
+	// specified file, replacing the current history with its contents.
+	// If homeDir is true, path is relative to the user's home directory.
+	void shareHistory(std::string const &path, bool homeDir = true);
 	// Add the specified string to the end of the history.
+	// Throws if the history file could not be written, in which case the
+	// string is not added.
 	void addHistory(std::string command);
 	
 	// Push a character of input to the console.
 	bool putc(char c);
+	// Push a chunk of input to the console, refreshing the display only once.
+	// Returns false if the console has been terminated, in which case any
+	// remaining input is discarded.
+	bool feed(char const *data, size_t size);
+	bool feed(std::string_view data) { return feed(data.data(), data.size()); }
+	// Enter the final line of input in batch mode even if it is incomplete,
+	// as done when the input is closed.
+	void finishInput();
+	
+	// Print the specified message above the command prompt.
+	// May be called from any thread without blocking; the message is written
+	// by the console thread on its next input, poll or flushMessages call.
+	void print(std::string message);
+	// Retrieve a file descriptor that becomes readable when printed messages
+	// are pending, for registration with an event loop (-1 if unsupported).
+	int messageFd() const { return _messageFds[0]; }
+	// Write all pending printed messages, repainting the command prompt once.
+	void flushMessages();
+	
+	// Retrieve the input file descriptor, for registration with an event loop.
+	int inputFd() const { return _input; }
+	// Read and process the available input once the input is readable.
+	// Returns false if the console has been terminated or the input closed.
+	bool onReadable();
+	// Wait up to timeout milliseconds (indefinitely if negative) for input and
+	// process it. Returns false if the console has been terminated or the input
+	// closed.
+	bool poll(int timeout = -1);
+	
+	// Retrieve the number of bytes rendered while processing the most recent
+	// input.
+	size_t renderedBytes() const { return _renderedBytes; }
+	// Retrieve the total number of bytes rendered by the console.
+	size_t totalRenderedBytes() const { return _renderer.totalBytes(); }
+	
+	// Retrieve a snapshot of the metrics of the console and its history, empty
+	// unless compiled in with CONSOLE_METRICS.
+	ConsoleMetrics metrics() const;
+	// Reset all metrics of the console and its history.
+	void resetMetrics();
+	
+protected:
+	// Access the command history, e.g. to configure it, taking over its
+	// browsing and search state from other consoles sharing it.
+	History &history() {
+		_history->attach(_session);
+		return *_history;
+	}
+	// Access the vocabulary completed by default.
+	Trie &vocabulary() { return _vocabulary; }
+	// Set the maximum number of completion candidates listed at once.
+	void setCompletionPageSize(size_t size) { _completionPageSize = size; }
 	
 private:
 	// Called when a command has been entered.
 	virtual void onCommand(std::string command) = 0;
+	// Called when completion of the word before the cursor is requested. Add
+	// candidates and finish the completion, either before returning or later
+	// from any thread. Completes from the vocabulary by default.
+	virtual void onComplete(std::shared_ptr<Completion> completion);
+	
+private:
+	// Terminal mode of the input, restored on destruction.
+	class RawMode;
+	
+	// Message printed by any thread, queued in a lock-free stack.
+	struct Message {
+		std::string text;
+		Message *next;
+	};
 	
 private:
+	// Process a character of input without refreshing the display.
+	bool process(char c);
+	// Insert the specified text at the cursor.
+	void insert(std::string_view text);
+	// Enter every complete line of the specified input as a command, keeping
+	// an incomplete final line for the next input.
+	void enterLines(char const *data, size_t size);
+	// Enter the specified line as a command, unless it is empty.
+	void enterLine(std::string_view line);
+	
+	// Collect pasted text up to the end of the paste, returning the number of
+	// bytes consumed.
+	size_t paste(char const *data, size_t size);
+	// Insert the collected pasted text according to the paste policy.
+	void finishPaste();
+	
+	// Mark the command prompt as requiring a refresh.
+	void invalidate() { _dirty = true; }
+	// Request completion of the word before the cursor.
+	void complete();
+	// Apply the candidates of the finished completion request.
+	void applyCompletion();
+	// List the next page of completion candidates above the command prompt.
+	void listCompletions();
+	// Abandon the current completion request.
+	void cancelCompletion();
+	
+	// Refresh the command prompt if it has been invalidated.
+	void update() { if(_dirty) { refresh(); } }
 	// Refresh the command prompt.
-	void refresh() const;
+	void refresh();
+	// Write the pending frame to the output.
+	void flush();
+	
+#if defined(CONSOLE_METRICS)
+	// Count growths of the frame, display and command line buffers.
+	void countAllocations();
+#endif
 	
 private:
-	// Command history.
-	History _history;
+	// Command history, possibly shared, and the browsing and search state of
+	// this console.
+	std::shared_ptr<History> _history;
+	History::Session _session;
+	// Input file descriptor read from.
+	int _input;
+	// Raw mode of the input terminal, unless headless or in batch mode.
+	std::unique_ptr<RawMode> _rawMode;
+	// Output written to.
+	Output *_output;
+	// Pending printed messages, newest first.
+	std::atomic<Message *> _messages;
+	// Pipe signalling pending printed messages.
+	int _messageFds[2];
+	// Buffer for assembling output written to the terminal.
+	std::string _frame;
+	// Differential renderer for the command prompt.
+	Renderer _renderer;
 	
 	// The current command prompt.
 	std::string _prompt;
-	// Buffer for partial escape sequences.
-	std::string _escBuffer;
+	// Decoder for partial escape sequences.
+	CSI::Decoder _decoder;
 	// Buffer for partial utf8 sequences.
 	std::string _utf8Buffer;
 	// The current command being entered.
-	std::string _commandLine;
+	LineBuffer _commandLine;
+	// Buffer for the displayed command prompt.
+	std::string _display;
+	// Indicator that _display holds the prompt followed by the command line as
+	// of the previous refresh, so that only the modified tail is rebuilt.
+	bool _displayLine;
 	// Position of the cursor within command.
 	size_t _cursor;
+	// Handling of pasted text spanning multiple lines.
+	PastePolicy _pastePolicy;
+	// Indicator of text being pasted, the text collected so far and the
+	// number of bytes of the end sequence matched at its end.
+	bool _pasting;
+	std::string _pasteBuffer;
+	size_t _pasteMatched;
+	// Indicator of batch mode, and the incomplete line of input it received.
+	bool _batch;
+	std::string _batchLine;
 	// Toggle for displaying the command line.
 	bool _showPrompt;
 	// Indicator of an active history search.
 	bool _search;
+	
+	// Words completed by default.
+	Trie _vocabulary;
+	// Current completion request, kept after applying it for listing.
+	std::shared_ptr<Completion> _completion;
+	// Indicator of a completion request that has not been applied yet.
+	bool _completing;
+	// Number of completion candidates already listed.
+	size_t _completionOffset;
+	// Maximum number of completion candidates listed at once.
+	size_t _completionPageSize;
+	
+	// Indicator of a pending refresh of the command prompt.
+	bool _dirty;
+	// Number of bytes rendered while processing the most recent input.
+	size_t _renderedBytes;
 	// The most recently pushed character.
 	char _prev;
+	
+#if defined(CONSOLE_METRICS)
+	// Metrics, excluding those of the history.
+	ConsoleMetrics _metrics;
+	// Total capacity of the frame, display and command line buffers.
+	size_t _capacity;
+#endif
 };
 
 }
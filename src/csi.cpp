@@ -0,0 +1,154 @@
+#include "csi.h"
+
+#include <array>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//                     Begin namespace <helper functions>                     //
+namespace {
+
+//------------------------------------------------------------------------------
+//--                           Key Decoding Tables                            --
+//------------------------------------------------------------------------------
+using KeyTable = std::array<CSI::Key, 128>;
+
+// Keys identified by the final byte of a CSI sequence (ESC [ ... X).
+KeyTable constexpr csiKeys = [] {
+	KeyTable table {};
+	table['A'] = CSI::Key::UP_ARROW;
+	table['B'] = CSI::Key::DOWN_ARROW;
+	table['C'] = CSI::Key::RIGHT_ARROW;
+	table['D'] = CSI::Key::LEFT_ARROW;
+	table['F'] = CSI::Key::END;
+	table['H'] = CSI::Key::HOME;
+	return table;
+}();
+
+// Keys identified by the final byte of an SS3 sequence (ESC O X).
+KeyTable constexpr ss3Keys = [] {
+	KeyTable table {};
+	table['A'] = CSI::Key::SHIFT_UP_ARROW;
+	table['B'] = CSI::Key::SHIFT_DOWN_ARROW;
+	table['C'] = CSI::Key::SHIFT_RIGHT_ARROW;
+	table['D'] = CSI::Key::SHIFT_LEFT_ARROW;
+	table['F'] = CSI::Key::END;
+	table['H'] = CSI::Key::HOME;
+	return table;
+}();
+
+// Keys identified by the first parameter of a VT sequence (ESC [ n ~).
+std::array<CSI::Key, 9> constexpr vtKeys {
+	CSI::Key::INVALID,
+	CSI::Key::HOME,
+	CSI::Key::INSERT,
+	CSI::Key::DEL,
+	CSI::Key::END,
+	CSI::Key::PAGE_UP,
+	CSI::Key::PAGE_DOWN,
+	CSI::Key::HOME,
+	CSI::Key::END
+};
+
+// Retrieve the modified variant of a key.
+CSI::Key constexpr modified(CSI::Key key) {
+	switch(key) {
+	case CSI::Key::UP_ARROW:    return CSI::Key::SHIFT_UP_ARROW;
+	case CSI::Key::DOWN_ARROW:  return CSI::Key::SHIFT_DOWN_ARROW;
+	case CSI::Key::RIGHT_ARROW: return CSI::Key::SHIFT_RIGHT_ARROW;
+	case CSI::Key::LEFT_ARROW:  return CSI::Key::SHIFT_LEFT_ARROW;
+	default:                    return key;
+	}
+}
+
+}
+//                      End namespace <helper functions>                      //
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//--                         Escape Sequence Decoder                          --
+//------------------------------------------------------------------------------
+
+// Start decoding an escape sequence after receiving ESC.
+void CSI::Decoder::start() {
+	_state = State::ESCAPE;
+	_paramCount = 0;
+	_modifiers = 0;
+	_rawSize = 0;
+}
+
+// Push the next byte of an escape sequence to the decoder.
+CSI::Key CSI::Decoder::push(char c) {
+	if(_rawSize < sizeof(_raw)) {
+		_raw[_rawSize++] = c;
+	}
+	
+	uint8_t byte = uint8_t(c);
+	switch(_state) {
+	case State::ESCAPE:
+		if(c == '[') {
+			_state = State::CSI;
+			_params[0] = 0;
+			_paramCount = 1;
+			return Key::INCOMPLETE;
+		} else if(c == 'O') {
+			_state = State::SS3;
+			return Key::INCOMPLETE;
+		}
+		return finish(Key::INVALID);
+	case State::SS3:
+		return finish(byte < 0x80 ? ss3Keys[byte] : Key::INVALID);
+	case State::CSI:
+		if(c >= '0' && c <= '9') {
+			// Accumulate parameter, saturating on overflow.
+			unsigned &param = _params[_paramCount - 1];
+			if(param < 10000) {
+				param = param * 10 + (c - '0');
+			}
+			return Key::INCOMPLETE;
+		} else if(c == ';') {
+			if(_paramCount < maxParams) {
+				_params[_paramCount++] = 0;
+			}
+			return Key::INCOMPLETE;
+		} else if(byte >= 0x20 && byte < 0x40) {
+			// Ignore private markers and intermediate bytes.
+			return Key::INCOMPLETE;
+		} else if(byte < 0x40 || byte > 0x7e) {
+			return finish(Key::INVALID);
+		}
+		
+		// Final byte; the second parameter encodes modifiers plus one.
+		if(_paramCount > 1 && _params[1] > 1) {
+			_modifiers = (_params[1] - 1) & (SHIFT | ALT | CTRL | META);
+		}
+		if(c == '~') {
+			if(_params[0] == 200) {
+				return finish(Key::PASTE_BEGIN);
+			} else if(_params[0] == 201) {
+				return finish(Key::PASTE_END);
+			}
+			Key key = _params[0] < vtKeys.size() ? vtKeys[_params[0]]
+			                                     : Key::INVALID;
+			return finish(key);
+		}
+		if(_modifiers) {
+			return finish(modified(csiKeys[byte]));
+		}
+		return finish(csiKeys[byte]);
+	default:
+		return finish(Key::INVALID);
+	}
+}
+
+// Finish decoding with the specified key.
+CSI::Key CSI::Decoder::finish(Key key) {
+	_state = State::GROUND;
+	return key;
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
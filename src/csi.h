@@ -0,0 +1,148 @@
+#ifndef CONSOLE_CSI_H
+#define CONSOLE_CSI_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                           CSI Escape Sequences                           --
+//------------------------------------------------------------------------------
+namespace CSI {
+	// Graphic parameters.
+	auto constexpr resetAttributes = "\033[0m";
+	auto constexpr bright = "\033[1m";
+	
+	// Foreground colors.
+	auto constexpr black = "\033[30m";
+	auto constexpr red = "\033[31m";
+	auto constexpr green = "\033[32m";
+	auto constexpr yellow = "\033[33m";
+	auto constexpr blue = "\033[34m";
+	auto constexpr magenta = "\033[35m";
+	auto constexpr cyan = "\033[36m";
+	auto constexpr white = "\033[37m";
+	
+	// Background colors.
+	auto constexpr bgBlack = "\033[40m";
+	auto constexpr bgRed = "\033[41m";
+	auto constexpr bgGreen = "\033[42m";
+	auto constexpr bgYellow = "\033[43m";
+	auto constexpr bgBlue = "\033[44m";
+	auto constexpr bgMagenta = "\033[45m";
+	auto constexpr bgCyan = "\033[46m";
+	auto constexpr bgWhite = "\033[47m";
+	
+	// Display refresh.
+	auto constexpr clear = "\033[2K\r";
+	auto constexpr clearToEnd = "\033[K";
+	
+	// Cursor movement.
+	auto constexpr up = "\033[A";
+	auto constexpr down = "\033[B";
+	auto constexpr right = "\033[C";
+	auto constexpr left = "\033[D";
+	
+	// Bracketed paste mode, in which the terminal surrounds pasted text with
+	// PASTE_BEGIN and PASTE_END sequences.
+	auto constexpr enablePaste = "\033[?2004h";
+	auto constexpr disablePaste = "\033[?2004l";
+	// Sequence ending pasted text.
+	auto constexpr pasteEnd = "\033[201~";
+	
+	// Key codes corresponding to escape sequences.
+	enum Key {
+		INVALID,
+		INCOMPLETE,
+		
+		UP_ARROW,
+		DOWN_ARROW,
+		RIGHT_ARROW,
+		LEFT_ARROW,
+		
+		SHIFT_UP_ARROW,
+		SHIFT_DOWN_ARROW,
+		SHIFT_RIGHT_ARROW,
+		SHIFT_LEFT_ARROW,
+		
+		HOME,
+		END,
+		INSERT,
+		DEL,
+		PAGE_UP,
+		PAGE_DOWN,
+		
+		PASTE_BEGIN,
+		PASTE_END
+	};
+	
+	// Modifier flags of a decoded escape sequence.
+	enum Modifier {
+		SHIFT = 0x1,
+		ALT   = 0x2,
+		CTRL  = 0x4,
+		META  = 0x8
+	};
+	
+	// Table-driven decoder for escape sequences, consuming one byte at a time.
+	// Generic CSI sequences of the form ESC [ n ; m X are parsed into their
+	// parameters, so modified keys are decoded without dedicated table entries.
+	class Decoder {
+	public:
+		Decoder()
+		: _state(State::GROUND)
+		, _paramCount(0)
+		, _modifiers(0)
+		, _rawSize(0) { }
+		
+		// Check if an escape sequence is being decoded.
+		bool active() const { return _state != State::GROUND; }
+		// Start decoding an escape sequence after receiving ESC.
+		void start();
+		// Abort decoding of any escape sequence.
+		void reset() { _state = State::GROUND; }
+		
+		// Push the next byte of an escape sequence to the decoder.
+		// Returns INCOMPLETE while more bytes are required, otherwise the
+		// decoded key or INVALID, after which the decoder is no longer active.
+		Key push(char c);
+		
+		// Retrieve the modifier flags of the most recently decoded key.
+		unsigned modifiers() const { return _modifiers; }
+		// Retrieve the (possibly truncated) bytes following ESC of the most
+		// recent escape sequence, for diagnostics.
+		std::string_view sequence() const { return { _raw, _rawSize }; }
+		
+	private:
+		// Finish decoding with the specified key.
+		Key finish(Key key);
+		
+	private:
+		enum class State : uint8_t {
+			GROUND,
+			ESCAPE,
+			CSI,
+			SS3
+		};
+		
+		// Maximum number of CSI parameters retained.
+		static size_t constexpr maxParams = 4;
+		
+		State _state;
+		unsigned _params[maxParams];
+		size_t _paramCount;
+		unsigned _modifiers;
+		char _raw[16];
+		size_t _rawSize;
+	};
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
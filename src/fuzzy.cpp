@@ -0,0 +1,150 @@
+#include "fuzzy.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#	include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//                     Begin namespace <helper functions>                     //
+namespace {
+
+//------------------------------------------------------------------------------
+//--                         Character Helper Functions                       --
+//------------------------------------------------------------------------------
+bool isLower(char c) { return c >= 'a' && c <= 'z'; }
+bool isUpper(char c) { return c >= 'A' && c <= 'Z'; }
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+bool isWord(char c) {
+	return isLower(c) || isUpper(c) || isDigit(c) || (c & 0x80);
+}
+
+// Check if a word starts at position pos of text.
+bool isBoundary(std::string_view text, size_t pos) {
+	if(!pos) {
+		return true;
+	}
+	char prev = text[pos - 1];
+	return !isWord(prev) || (isLower(prev) && isUpper(text[pos]));
+}
+
+// Find the first occurrence of a or b in [pos, end), or nullptr.
+char const *findEither(char const *pos, char const *end, char a, char b) {
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+	__m128i const va = _mm_set1_epi8(a);
+	__m128i const vb = _mm_set1_epi8(b);
+	for(; end - pos >= 16; pos += 16) {
+		__m128i chunk = _mm_loadu_si128((__m128i const *)pos);
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, va),
+		                                          _mm_cmpeq_epi8(chunk, vb)));
+		if(mask) {
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return pos + index;
+#else
+			return pos + __builtin_ctz(mask);
+#endif
+		}
+	}
+#endif
+	for(; pos != end; ++pos) {
+		if(*pos == a || *pos == b) {
+			return pos;
+		}
+	}
+	return nullptr;
+}
+
+// Score components.
+int constexpr matchScore = 16;
+int constexpr boundaryBonus = 8;
+int constexpr adjacentBonus = 8;
+int constexpr gapStartPenalty = 3;
+int constexpr gapPenalty = 1;
+
+}
+//                      End namespace <helper functions>                      //
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//--                           Class FuzzyMatcher                             --
+//------------------------------------------------------------------------------
+
+// Construct a matcher for the specified query.
+FuzzyMatcher::FuzzyMatcher(std::string_view query)
+: _query(query)
+, _upper(query) {
+	bool caseSensitive = false;
+	for(char c : query) {
+		caseSensitive |= isUpper(c);
+	}
+	if(!caseSensitive) {
+		for(char &c : _upper) {
+			if(isLower(c)) {
+				c = char(c - 'a' + 'A');
+			}
+		}
+	}
+}
+
+// Score the text, returning a negative value if it does not match.
+int FuzzyMatcher::score(std::string_view text) const {
+	if(_query.empty()) {
+		return 0;
+	}
+	
+	// Find the earliest end of a match, skipping ahead a chunk at a time.
+	char const *pos = text.data();
+	char const *end = text.data() + text.size();
+	for(size_t i = 0; i < _query.size(); ++i) {
+		pos = findEither(pos, end, _query[i], _upper[i]);
+		if(!pos) {
+			return -1;
+		}
+		++pos;
+	}
+	size_t last = size_t(pos - text.data()) - 1;
+	
+	// Scan backward from there for the latest start, giving the shortest match
+	// window ending at last.
+	size_t first = last;
+	for(size_t i = _query.size(); i;) {
+		if(matches(text[first], i - 1) && !--i) {
+			break;
+		}
+		--first;
+	}
+	
+	// Score the window, matching greedily from its start.
+	int score = 0;
+	bool adjacent = false;
+	size_t i = 0;
+	for(size_t p = first; p <= last; ++p) {
+		if(i < _query.size() && matches(text[p], i)) {
+			score += matchScore;
+			if(isBoundary(text, p)) {
+				score += boundaryBonus;
+			}
+			if(adjacent) {
+				score += adjacentBonus;
+			}
+			adjacent = true;
+			++i;
+		} else {
+			score -= adjacent ? gapStartPenalty : gapPenalty;
+			adjacent = false;
+		}
+	}
+	return score < 0 ? 0 : score;
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
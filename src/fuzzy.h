@@ -0,0 +1,42 @@
+#ifndef CONSOLE_FUZZY_H
+#define CONSOLE_FUZZY_H
+
+#include <string>
+#include <string_view>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                           Class FuzzyMatcher                             --
+//------------------------------------------------------------------------------
+// Matches text containing the characters of a query in order, not necessarily
+// adjacent. Matching ignores case unless the query contains upper case
+// letters. Scores reward adjacent matches and matches at word boundaries and
+// penalize gaps.
+class FuzzyMatcher {
+public:
+	// Construct a matcher for the specified query.
+	explicit FuzzyMatcher(std::string_view query);
+	
+	// Score the text, returning a negative value if it does not match.
+	int score(std::string_view text) const;
+	
+private:
+	// Check if the text character c matches query character i.
+	bool matches(char c, size_t i) const {
+		return c == _query[i] || c == _upper[i];
+	}
+	
+private:
+	// Query, and its upper case variant when matching ignores case.
+	std::string _query;
+	std::string _upper;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
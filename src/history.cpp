@@ -1,6 +1,10 @@
 #include "history.h"
+#include "fuzzy.h"
+#include "historyfile.h"
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 
 //------------------------------------------------------------------------------
 //                          Begin namespace Console                           //
@@ -45,34 +49,12 @@ std::string toHomePath(std::string const &path) {
 }
 
 //------------------------------------------------------------------------------
-//--                         GetLine Helper Function                          --
+//--                           Fuzzy Search Tuning                            --
 //------------------------------------------------------------------------------
-// See https://stackoverflow.com/a/6089413/694509.
-std::istream &safeGetLine(std::istream &is, std::string &line) {
-	line.clear();
-	
-	std::istream::sentry se(is, true);
-	std::streambuf *sb = is.rdbuf();
-	while(true) {
-		int c = sb->sbumpc();
-		switch(c) {
-		case '\n':
-			return is;
-		case '\r':
-			if(sb->sgetc() == '\n') {
-				sb->sbumpc();
-			}
-			return is;
-		case std::streambuf::traits_type::eof():
-			if(line.empty()) {
-				is.setstate(std::ios::eofbit);
-			}
-			return is;
-		default:
-			line += (char)c;
-		}
-	}
-}
+// Number of entries from which ranking is split across threads.
+size_t constexpr parallelEntries = 16384;
+// Maximum score added for recency, favouring the newest of similar matches.
+int constexpr recencyBonus = 16;
 
 }
 //                      End namespace <helper functions>                      //
@@ -83,80 +65,254 @@ std::istream &safeGetLine(std::istream &is, std::string &line) {
 //------------------------------------------------------------------------------
 
 // Construct a history with the specified maximum size.
-History::History(size_t maxSize)
-: _history(maxSize > 1 ? maxSize : 2)
+History::History(size_t maxSize, size_t maxBytes)
+: _history(maxSize > 1 ? maxSize : 2, maxBytes)
 , _pos(0)
-, _head(0)
-, _full(false)
-, _search(false) { }
+, _search(false)
+, _fuzzy(false)
+, _fuzzyLimit(100)
+, _session(nullptr)
+, _count(0)
+, _epoch(0)
+, _indexed(false)
+, _deduplicated(false) { }
 
 // Load history from the specified file.
 void History::load(std::string const &path, bool homeDir) {
-	_pos = 0;
-	_head = 0;
-	_full = false;
+	clear();
 	
-	std::ifstream file(homeDir ? toHomePath(path) : path);
-	for(std::string line; safeGetLine(file, line);) {
-		if(!line.empty()) {
-			push(line);
-		}
+	// Only parse the entries retained by the ring.
+	CONSOLE_METRIC(ScopedTimer timer(_metrics.loadTime);)
+	MappedFile file(homeDir ? toHomePath(path) : path);
+	for(std::string_view line : tailLines(file, _history.maxEntries(),
+	                                      _deduplicated)) {
+		add(line);
 	}
+	CONSOLE_METRIC(_metrics.loadedEntries += size();)
 }
 
 // Save history to the specified file.
 void History::save(std::string const &path, bool homeDir) const {
 	if(!empty()) {
+		CONSOLE_METRIC(ScopedTimer timer(_metrics.saveTime);)
+		CONSOLE_METRIC(_metrics.savedEntries += size();)
 		std::ofstream file(homeDir ? toHomePath(path) : path);
-		size_t i = 0;
-		if(_full) {
-			file << _history[_head] << std::endl;
-			i = next(_head);
-		}
-		for(; i != _head; i = next(i)) {
-			file << _history[i] << std::endl;
+		for(size_t i = 0; i < _history.size(); ++i) {
+			if(!_history.removed(i)) {
+				file << _history[i] << '\n';
+			}
 		}
+		file.flush();
 	}
 }
 
+// Append all subsequently pushed entries to the specified file.
+void History::journal(std::string const &path, bool homeDir) {
+	_shared.reset();
+	_journal.reset();
+	_journal.reset(new Journal(homeDir ? toHomePath(path) : path,
+	                           _history.maxEntries()));
+}
+
+// Share the history with concurrent processes through the specified file.
+void History::share(std::string const &path, bool homeDir) {
+	_journal.reset();
+	_shared.reset();
+	_shared.reset(new SharedFile(homeDir ? toHomePath(path) : path,
+	                             _history.maxEntries()));
+	cancel();
+	merge(_shared->update(_merged));
+}
+
 // Append the specified command to the history.
 void History::push(std::string command) {
-	// Ignore duplicate entries.
-	if(!empty() && command == _history[prev(_head)]) {
+	// Ignore duplicate and oversized entries.
+	if((!empty() && command == _history.back()) ||
+	   !_history.fits(command.size())) {
+		return;
+	}
+	
+	if(_shared) {
+		// Merge entries of other processes preceding the command.
+		merge(_shared->append(command, _merged));
+	}
+	if(_journal) {
+		_journal->append(command);
+	}
+	add(command);
+}
+
+// Merge entries appended to the shared history file by other processes.
+void History::merge() {
+	if(_shared && !_pos && !_search) {
+		merge(_shared->update(_merged));
+	}
+}
+
+// Write and sync the journaled entries, waiting for completion.
+void History::sync() {
+	if(_journal) {
+		_journal->sync();
+	}
+}
+
+// Add the specified command to the history without recording it in a file.
+void History::add(std::string_view command) {
+	// Ignore duplicate and oversized entries.
+	if((!empty() && command == _history.back()) ||
+	   !_history.fits(command.size())) {
 		return;
 	}
 	
-	_history[_head] = std::move(command);
-	++_head;
-	if(_head >= _history.size()) {
-		_head = 0;
-		_full = true;
+	// Move an existing entry to the head by removing its previous occurrence.
+	size_t hash = 0;
+	if(_deduplicated) {
+		hash = std::hash<std::string_view>()(command);
+		size_t bucket = findUnique(command, hash);
+		if(_unique[bucket].seq != emptyBucket) {
+			_history.remove(size_t(_unique[bucket].seq - oldest()));
+			eraseUnique(bucket);
+		}
+		// Reclaim removed entries while they are not referenced by browsing.
+		if(_history.removed() > _history.size() / 2 && !_pos && !_search) {
+			compact();
+		}
+	}
+	
+	while(_history.full(command.size())) {
+		// Reclaim removed entries rather than dropping live ones for want of
+		// bytes once they take up a quarter of the buffer, so compaction
+		// stays rare, unless browsing refers to entries by position.
+		if(_history.removedBytes() >= _history.capacity() / 4 &&
+		   _history.removed() && size() < _history.maxEntries() &&
+		   !_pos && !_search) {
+			compact();
+		} else {
+			pop();
+		}
+	}
+	
+	if(_indexed) {
+		_index.insert(_count, command);
+	}
+	
+	// Keep the results of an active search up to date.
+	if(_search && !_fuzzy && !_query.empty() &&
+	   command.find(_query) != std::string_view::npos) {
+		_matches.push_back(_count);
+	}
+	
+#if defined(CONSOLE_METRICS)
+	size_t capacity = _history.capacity();
+	_history.push(command);
+	_metrics.allocations += _history.capacity() > capacity;
+#else
+	_history.push(command);
+#endif
+	++_count;
+	
+	// Insert the entry once it is stored, as the table compares entries.
+	if(_deduplicated) {
+		insertUnique(_count - 1, hash);
+	}
+	
+	// Stay within the history if entries were dropped while browsing.
+	if(_pos > _history.size()) {
+		_pos = _history.size();
 	}
 }
 
+// Limit the number of bytes of entry storage, dropping old entries.
+void History::setMaxBytes(size_t maxBytes) {
+	while(_history.bytes() > maxBytes) {
+		pop();
+	}
+	_history.setMaxBytes(maxBytes);
+	if(_pos > _history.size()) {
+		_pos = _history.size();
+	}
+}
+
+// Enable or disable the trigram index used to accelerate searches.
+void History::setIndexed(bool indexed) {
+	_index.clear();
+	_indexed = indexed;
+	if(_indexed) {
+		for(uint64_t seq = oldest(); seq < _count; ++seq) {
+			_index.insert(seq, entry(seq));
+		}
+	}
+}
+
+// Enable or disable global deduplication.
+void History::setDeduplicated(bool deduplicated) {
+	_deduplicated = deduplicated;
+	if(_deduplicated) {
+		// Remove all but the most recent occurrence of each entry.
+		_unique.clear();
+		_unique.resize(4, { emptyBucket, 0 });
+		while(_unique.size() < 2 * _history.maxEntries()) {
+			_unique.resize(_unique.size() * 2, { emptyBucket, 0 });
+		}
+		for(uint64_t seq = oldest(); seq < _count; ++seq) {
+			if(removed(seq)) {
+				continue;
+			}
+			size_t hash = std::hash<std::string_view>()(entry(seq));
+			size_t bucket = findUnique(entry(seq), hash);
+			if(_unique[bucket].seq != emptyBucket) {
+				_history.remove(size_t(_unique[bucket].seq - oldest()));
+				_unique[bucket].seq = seq;
+			} else {
+				_unique[bucket] = { seq, hash };
+			}
+		}
+	} else {
+		_unique.clear();
+		_unique.shrink_to_fit();
+	}
+}
+
+// Enable or disable fuzzy search.
+void History::setFuzzy(bool fuzzy, size_t limit) {
+	cancel();
+	_fuzzy = fuzzy;
+	_fuzzyLimit = limit ? limit : 1;
+}
+
+// Retrieve the ranked results of the active fuzzy search, best first.
+std::vector<std::string_view> History::ranked() const {
+	std::vector<std::string_view> results;
+	if(_search && _fuzzy) {
+		for(uint64_t seq : _matches) {
+			if(seq >= oldest() && !removed(seq)) {
+				results.push_back(entry(seq));
+			}
+		}
+	}
+	return results;
+}
+
 // Retrieve the currently selected history entry.
-std::string const &History::current() const {
+std::string_view History::current() const {
 	if(!_pos) {
 		return _stored;
 	} else {
-		return _history[prev(_head, _pos)];
+		return _history[_history.size() - _pos];
 	}
 }
 
 // Browse or search backward to the previous history entry.
-std::string const &History::backward(std::string const &command) {
+std::string_view History::backward(std::string_view command) {
 	if(_search) {
 		// String to search for is emptied when there are no results.
 		if(_stored.empty()) {
 			return _stored;
 		}
 		// Search backward through history for the search string.
-		for(size_t pos = _pos; ++pos <= size();) {
-			std::string const &entry = _history[prev(_head, pos)];
-			if(entry.find(_stored) != std::string::npos) {
-				_pos = pos;
-				return entry;
-			}
+		if(size_t pos = findBackward()) {
+			_pos = pos;
+			return current();
 		}
 		// Clear search string if there are no results.
 		if(!_pos) {
@@ -166,15 +322,19 @@ std::string const &History::backward(std::string const &command) {
 		if(!_pos) {
 			_stored = command;
 		}
-		if(_pos < size()) {
-			++_pos;
+		// Step to the previous entry that has not been removed.
+		for(size_t pos = _pos; pos < _history.size();) {
+			if(!removed(_count - ++pos)) {
+				_pos = pos;
+				break;
+			}
 		}
 	}
 	return current();
 }
 
 // Browse or search forward to the next history entry.
-std::string const &History::forward(std::string const &command) {
+std::string_view History::forward(std::string_view command) {
 	if(_search) {
 		// String to search for is emptied when there are no results.
 		// Since search initially calls backward, if _stored is not empty there
@@ -183,24 +343,38 @@ std::string const &History::forward(std::string const &command) {
 			return _stored;
 		}
 		// Search forward through history for the search string.
-		for(size_t pos = _pos; --pos;) {
-			std::string const &entry = _history[prev(_head, pos)];
-			if(entry.find(_stored) != std::string::npos) {
-				_pos = pos;
-				return entry;
-			}
+		if(size_t pos = findForward()) {
+			_pos = pos;
+			return current();
 		}
 	} else {
 		if(!_pos) {
 			return command;
 		}
-		--_pos;
+		while(--_pos && removed(_count - _pos));
 	}
 	return current();
 }
 
 // Start searching the history for the specified string.
 void History::search(std::string str) {
+	CONSOLE_METRIC(ScopedTimer timer(_metrics.searchTime);)
+	CONSOLE_METRIC(uint64_t visited = _metrics.visited;)
+	if(_fuzzy) {
+		_query = str;
+		rankMatches();
+	// Results of an extended search string are a subset of the previous ones.
+	} else if(_search && !_query.empty() &&
+	          str.find(_query) != std::string::npos) {
+		_query = str;
+		narrowMatches();
+	} else {
+		_query = str;
+		collectMatches();
+	}
+	CONSOLE_METRIC(++_metrics.searches;)
+	CONSOLE_METRIC(_metrics.searchVisited.record(_metrics.visited - visited);)
+	
 	_stored = std::move(str);
 	_pos = 0;
 	_search = true;
@@ -210,10 +384,328 @@ void History::search(std::string str) {
 // Cancel any search and reset browsing position to the head of the history.
 void History::cancel() {
 	_stored.clear();
+	_query.clear();
+	_matches.clear();
 	_pos = 0;
 	_search = false;
 }
 
+// Forget the specified session.
+void History::detach(Session &session) {
+	if(_session == &session) {
+		_session = nullptr;
+		cancel();
+	}
+}
+
+// Retrieve a snapshot of the metrics, empty unless compiled in.
+HistoryMetrics History::metrics() const {
+#if defined(CONSOLE_METRICS)
+	return _metrics;
+#else
+	return HistoryMetrics();
+#endif
+}
+
+// Reset all metrics.
+void History::resetMetrics() {
+	CONSOLE_METRIC(_metrics = HistoryMetrics();)
+}
+
+// Remove the oldest entry.
+void History::pop() {
+	if(_indexed) {
+		_index.erase(oldest(), _history.front());
+	}
+	if(_deduplicated && !_history.removed(0)) {
+		std::string_view front = _history.front();
+		eraseUnique(findUnique(front, std::hash<std::string_view>()(front)));
+	}
+	_history.pop();
+}
+
+// Remove all entries.
+void History::clear() {
+	_history.clear();
+	_count = 0;
+	++_epoch;
+	_index.clear();
+	rebuildUnique();
+	cancel();
+}
+
+// Add entries merged from the shared history file.
+void History::merge(bool reload) {
+	if(reload) {
+		clear();
+	}
+	for(std::string const &entry : _merged) {
+		add(entry);
+	}
+	_merged.clear();
+}
+
+// Reclaim the storage of removed entries, renumbering all entries.
+void History::compact() {
+	_history.compact();
+	++_epoch;
+	
+	// Sequence numbers have changed, so rebuild everything referencing them.
+	setIndexed(_indexed);
+	rebuildUnique();
+	_matches.clear();
+}
+
+// Find the bucket of the specified entry in the deduplication table.
+size_t History::findUnique(std::string_view entry, size_t hash) const {
+	size_t mask = _unique.size() - 1;
+	for(size_t bucket = hash & mask;; bucket = (bucket + 1) & mask) {
+		Bucket const &b = _unique[bucket];
+		if(b.seq == emptyBucket ||
+		   (b.hash == hash && this->entry(b.seq) == entry)) {
+			return bucket;
+		}
+	}
+}
+
+// Insert the entry with the specified sequence number and hash.
+void History::insertUnique(uint64_t seq, size_t hash) {
+	_unique[findUnique(entry(seq), hash)] = { seq, hash };
+}
+
+// Remove the specified bucket from the deduplication table.
+void History::eraseUnique(size_t bucket) {
+	// Shift subsequent buckets of the probe sequence backward.
+	size_t mask = _unique.size() - 1;
+	for(size_t next = (bucket + 1) & mask;; next = (next + 1) & mask) {
+		Bucket const &b = _unique[next];
+		if(b.seq == emptyBucket) {
+			break;
+		}
+		// Move the bucket if its home lies cyclically outside (bucket, next].
+		size_t home = b.hash & mask;
+		if(((next - home) & mask) >= ((next - bucket) & mask)) {
+			_unique[bucket] = b;
+			bucket = next;
+		}
+	}
+	_unique[bucket].seq = emptyBucket;
+}
+
+// Rebuild the deduplication table from the current entries.
+void History::rebuildUnique() {
+	if(_deduplicated) {
+		setDeduplicated(true);
+	}
+}
+
+// Collect all entries containing the search string into _matches.
+void History::collectMatches() {
+	_matches.clear();
+	if(_query.empty()) {
+		return;
+	}
+	
+	// Only verify the candidates narrowed down by the index.
+	if(Index::Postings const *candidates =
+	   _indexed ? _index.candidates(_query) : nullptr) {
+		auto it = std::lower_bound(candidates->begin(), candidates->end(),
+		                           oldest());
+		CONSOLE_METRIC(_metrics.visited += uint64_t(candidates->end() - it);)
+		for(; it != candidates->end(); ++it) {
+			if(!removed(*it) && entry(*it).find(_query) != std::string::npos) {
+				_matches.push_back(*it);
+			}
+		}
+		return;
+	}
+	
+	CONSOLE_METRIC(_metrics.visited += _count - oldest();)
+	for(uint64_t seq = oldest(); seq < _count; ++seq) {
+		if(!removed(seq) && entry(seq).find(_query) != std::string::npos) {
+			_matches.push_back(seq);
+		}
+	}
+}
+
+// Narrow _matches down to the entries containing the search string.
+void History::narrowMatches() {
+	CONSOLE_METRIC(_metrics.visited += _matches.size();)
+	_matches.erase(
+		std::remove_if(_matches.begin(), _matches.end(), [&](uint64_t seq) {
+			return seq < oldest() || removed(seq) ||
+			       entry(seq).find(_query) == std::string::npos;
+		}),
+		_matches.end()
+	);
+}
+
+// Rank the entries fuzzily matching the search string into _matches.
+void History::rankMatches() {
+	_matches.clear();
+	if(_query.empty()) {
+		return;
+	}
+	
+	struct Result {
+		int score;
+		uint64_t seq;
+	};
+	// Order results best first, preferring recent entries on equal scores.
+	auto better = [](Result const &a, Result const &b) {
+		return a.score != b.score ? a.score > b.score : a.seq > b.seq;
+	};
+	
+	FuzzyMatcher const matcher(_query);
+	uint64_t const first = oldest();
+	size_t const entries = size_t(_count - first);
+	CONSOLE_METRIC(_metrics.visited += entries;)
+	
+	// Split large histories into chunks ranked by separate threads.
+	size_t chunks = 1;
+	if(entries >= parallelEntries) {
+		if(!_pool) {
+			_pool = std::make_unique<ThreadPool>();
+		}
+		chunks = _pool->size() * 4;
+	}
+	std::vector<std::vector<Result>> results(chunks);
+	
+	// Keep the best results of a chunk in a heap with the worst on top.
+	auto rank = [&](size_t chunk) {
+		std::vector<Result> &best = results[chunk];
+		uint64_t end = first + entries * (chunk + 1) / chunks;
+		for(uint64_t seq = first + entries * chunk / chunks; seq < end; ++seq) {
+			if(removed(seq)) {
+				continue;
+			}
+			int score = matcher.score(entry(seq));
+			if(score < 0) {
+				continue;
+			}
+			score += int(recencyBonus * (seq - first) / entries);
+			Result result { score, seq };
+			if(best.size() < _fuzzyLimit) {
+				best.push_back(result);
+				std::push_heap(best.begin(), best.end(), better);
+			} else if(better(result, best.front())) {
+				std::pop_heap(best.begin(), best.end(), better);
+				best.back() = result;
+				std::push_heap(best.begin(), best.end(), better);
+			}
+		}
+	};
+	if(chunks > 1) {
+		_pool->run(chunks, rank);
+	} else {
+		rank(0);
+	}
+	
+	// Merge the best results of all chunks.
+	std::vector<Result> &best = results[0];
+	for(size_t chunk = 1; chunk < chunks; ++chunk) {
+		best.insert(best.end(), results[chunk].begin(), results[chunk].end());
+	}
+	size_t count = std::min(best.size(), _fuzzyLimit);
+	std::partial_sort(best.begin(), best.begin() + count, best.end(), better);
+	for(size_t i = 0; i < count; ++i) {
+		_matches.push_back(best[i].seq);
+	}
+}
+
+// Store the state of the current session and restore that of the specified
+// session.
+void History::switchSession(Session &session) {
+	if(_session) {
+		_session->stored.swap(_stored);
+		_session->query.swap(_query);
+		_session->matches.swap(_matches);
+		_session->pos = _pos;
+		_session->search = _search;
+		_session->fuzzy = _fuzzy;
+		_session->count = _count;
+		_session->epoch = _epoch;
+	}
+	_session = &session;
+	
+	// Sequence numbers stored before a renumbering are meaningless, as are
+	// results ranked for a different kind of search.
+	if(session.epoch != _epoch || session.fuzzy != _fuzzy) {
+		cancel();
+		return;
+	}
+	_stored.swap(session.stored);
+	_query.swap(session.query);
+	_matches.swap(session.matches);
+	_search = session.search;
+	
+	// Keep the selected entry despite entries pushed by other sessions.
+	_pos = 0;
+	if(session.pos) {
+		_pos = size_t(std::min<uint64_t>(session.pos + (_count - session.count),
+		                                 _history.size()));
+	}
+	// Add the entries pushed meanwhile to the results of an active search.
+	if(_search && !_fuzzy && !_query.empty()) {
+		for(uint64_t seq = std::max(session.count, oldest()); seq < _count;
+		    ++seq) {
+			if(!removed(seq) && entry(seq).find(_query) != std::string::npos) {
+				_matches.push_back(seq);
+			}
+		}
+	}
+}
+
+// Find the closest entry behind _pos containing the search string.
+size_t History::findBackward() const {
+	if(_fuzzy) {
+		// Step to the next ranked entry.
+		size_t rank = 0;
+		if(_pos) {
+			rank = size_t(std::find(_matches.begin(), _matches.end(),
+			                        _count - _pos) - _matches.begin()) + 1;
+		}
+		for(; rank < _matches.size(); ++rank) {
+			uint64_t seq = _matches[rank];
+			if(seq >= oldest() && !removed(seq)) {
+				return size_t(_count - seq);
+			}
+		}
+		return 0;
+	}
+	
+	auto it = std::lower_bound(_matches.begin(), _matches.end(), _count - _pos);
+	while(it != _matches.begin() && *--it >= oldest()) {
+		if(!removed(*it)) {
+			return size_t(_count - *it);
+		}
+	}
+	return 0;
+}
+
+// Find the closest entry ahead of _pos containing the search string.
+size_t History::findForward() const {
+	if(_fuzzy) {
+		// Step to the previous ranked entry.
+		auto it = std::find(_matches.begin(), _matches.end(), _count - _pos);
+		while(it != _matches.begin()) {
+			--it;
+			if(*it >= oldest() && !removed(*it)) {
+				return size_t(_count - *it);
+			}
+		}
+		return 0;
+	}
+	
+	auto it = std::upper_bound(_matches.begin(), _matches.end(), _count - _pos);
+	for(; it != _matches.end(); ++it) {
+		if(!removed(*it)) {
+			return size_t(_count - *it);
+		}
+	}
+	return 0;
+}
+
 }
 //                           End namespace Console                            //
 //------------------------------------------------------------------------------
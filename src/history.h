@@ -1,7 +1,17 @@
 #ifndef CONSOLE_HISTORY_H
 #define CONSOLE_HISTORY_H
 
+#include "arena.h"
+#include "index.h"
+#include "journal.h"
+#include "metrics.h"
+#include "sharedfile.h"
+#include "threadpool.h"
+
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 //------------------------------------------------------------------------------
@@ -13,8 +23,26 @@ namespace Console {
 //------------------------------------------------------------------------------
 class History {
 public:
-	// Construct a history with the specified maximum size.
-	History(size_t maxSize = 256);
+	// Browsing and search state of one of several consoles sharing a history.
+	// A console attaches its session before browsing or searching.
+	class Session {
+		friend class History;
+		
+		std::string stored;
+		std::string query;
+		std::vector<uint64_t> matches;
+		size_t pos = 0;
+		bool search = false;
+		bool fuzzy = false;
+		// Number of entries pushed and renumberings when the state was stored.
+		uint64_t count = 0;
+		uint64_t epoch = 0;
+	};
+	
+public:
+	// Construct a history with the specified maximum size, in entries and in
+	// bytes of entry storage.
+	History(size_t maxSize = 256, size_t maxBytes = size_t(-1));
 	
 	// Load history from the specified file.
 	// If homeDir is true, path is relative to the user's home directory.
@@ -22,23 +50,70 @@ public:
 	// Save history to the specified file.
 	// If homeDir is true, path is relative to the user's home directory.
 	void save(std::string const &path, bool homeDir = true) const;
+	// Append all subsequently pushed entries to the specified file, which is
+	// compacted in the background instead of being rewritten on save.
+	// If homeDir is true, path is relative to the user's home directory.
+	void journal(std::string const &path, bool homeDir = true);
+	// Share the history with concurrent processes through the specified file,
+	// replacing the current entries with those retained in the file.
+	// Subsequently pushed entries are appended to the file immediately.
+	// If homeDir is true, path is relative to the user's home directory.
+	void share(std::string const &path, bool homeDir = true);
+	// Merge entries appended to the shared history file by other processes.
+	// Has no effect while browsing or searching the history.
+	void merge();
+	// Write and sync the journaled entries, waiting for completion.
+	// Throws if journaled entries could not be written since the previous
+	// sync or push.
+	void sync();
 	
 	// Append the specified command to the history.
+	// Throws if the command could not be appended to the shared history file,
+	// or if journaled entries could not be written since the previous sync or
+	// push, in which case it is not added.
 	void push(std::string command);
 	
+	// Limit the number of bytes of entry storage, dropping old entries.
+	// Entries larger than the limit are not retained.
+	void setMaxBytes(size_t maxBytes);
+	
+	// Enable or disable the trigram index used to accelerate searches.
+	void setIndexed(bool indexed);
+	// Check if searches are accelerated by the trigram index.
+	bool indexed() const { return _indexed; }
+	
+	// Enable or disable global deduplication, in which pushing a command that
+	// is already in the history moves it to the head instead of adding it.
+	// Enable before loading, so that the most recent maxSize distinct entries
+	// of the file are retained. Entries read from a shared history file are
+	// counted without deduplication.
+	void setDeduplicated(bool deduplicated);
+	// Check if entries are deduplicated globally.
+	bool deduplicated() const { return _deduplicated; }
+	
+	// Enable or disable fuzzy search, in which searches rank the entries
+	// containing the characters of the search string in order, and browse the
+	// best limit of them, best first.
+	void setFuzzy(bool fuzzy, size_t limit = 100);
+	// Check if searches are fuzzy.
+	bool fuzzy() const { return _fuzzy; }
+	// Retrieve the ranked results of the active fuzzy search, best first.
+	// The results are invalidated by modifying the history.
+	std::vector<std::string_view> ranked() const;
+	
 	// Check if the history is empty.
-	bool empty() const { return !(_full || _head); }
+	bool empty() const { return !size(); }
 	// Retrieve the number of history entries.
-	size_t size() const { return (_full ? _history.size() : _head); }
+	size_t size() const { return _history.size() - _history.removed(); }
 	
 	// Retrieve the currently selected history entry.
-	std::string const &current() const;
+	std::string_view current() const;
 	// Browse or search backward to the previous history entry.
 	// Stores the specified command if not already browsing.
-	std::string const &backward(std::string const &command);
+	std::string_view backward(std::string_view command);
 	// Browse or search forward to the next history entry.
 	// Stores the specified command if not already browsing.
-	std::string const &forward(std::string const &command);
+	std::string_view forward(std::string_view command);
 	
 	// Check if the history is being searched.
 	bool searching() const { return _search; }
@@ -48,28 +123,125 @@ public:
 	// Cancel any search and reset browsing position to the head of the history.
 	void cancel();
 	
-private:
-	// Retrieve the history index n ahead of pos.
-	size_t next(size_t pos, size_t n = 1) const {
-		return ((pos + n) % _history.size());
+	// Make the specified session current, storing the browsing and search state
+	// of the previous one.
+	void attach(Session &session) {
+		if(_session != &session) {
+			switchSession(session);
+		}
 	}
+	// Forget the specified session, which must be called before destroying it.
+	void detach(Session &session);
+	
+	// Retrieve a snapshot of the metrics, empty unless compiled in.
+	HistoryMetrics metrics() const;
+	// Reset all metrics.
+	void resetMetrics();
 	
-	// Retrieve the history index n behind pos.
-	size_t prev(size_t pos, size_t n = 1) const {
-		return ((pos - n) % _history.size());
+private:
+	// Retrieve the sequence number of the oldest entry.
+	uint64_t oldest() const { return _count - _history.size(); }
+	// Retrieve the entry with the specified sequence number.
+	std::string_view entry(uint64_t seq) const {
+		return _history[size_t(seq - oldest())];
 	}
+	// Check if the entry with the specified sequence number has been removed.
+	bool removed(uint64_t seq) const {
+		return _history.removed(size_t(seq - oldest()));
+	}
+	
+	// Add the specified command to the history without recording it in a
+	// file.
+	void add(std::string_view command);
+	// Remove all entries.
+	void clear();
+	// Add the entries merged from the shared history file, replacing all
+	// entries if the file has been reloaded.
+	void merge(bool reload);
+	
+	// Remove the oldest entry.
+	void pop();
+	// Reclaim the storage of removed entries, renumbering all entries.
+	void compact();
+	
+	// Find the bucket of the specified entry in the deduplication table.
+	// Returns the empty bucket the entry would be inserted at if absent.
+	size_t findUnique(std::string_view entry, size_t hash) const;
+	// Insert the entry with the specified sequence number and hash into the
+	// deduplication table.
+	void insertUnique(uint64_t seq, size_t hash);
+	// Remove the specified bucket from the deduplication table.
+	void eraseUnique(size_t bucket);
+	// Rebuild the deduplication table from the current entries.
+	void rebuildUnique();
+	
+	// Collect all entries containing the search string into _matches.
+	void collectMatches();
+	// Narrow _matches down to the entries containing the search string.
+	void narrowMatches();
+	// Rank the entries fuzzily matching the search string into _matches.
+	void rankMatches();
+	
+	// Store the state of the current session and restore that of the specified
+	// session.
+	void switchSession(Session &session);
+	
+	// Find the closest entry behind _pos containing the search string.
+	// Returns the browsing position of the entry, or 0 if there is none.
+	size_t findBackward() const;
+	// Find the closest entry ahead of _pos containing the search string.
+	// Returns the browsing position of the entry, or 0 if there is none.
+	size_t findForward() const;
 	
 private:
 	// Store current command or search string while browsing history.
 	std::string _stored;
 	// Circular history queue.
-	std::vector<std::string> _history;
+	Arena _history;
+	// Browsing position, counting backward from the newest entry.
 	size_t _pos;
-	size_t _head;
-	// Indicator of a fully utilized history buffer.
-	bool _full;
 	// Indicator of an active history search.
 	bool _search;
+	// Search string of the active search, kept even if there are no results.
+	std::string _query;
+	// Sorted sequence numbers of the entries containing the search string, or
+	// of the best fuzzy matches, best first.
+	std::vector<uint64_t> _matches;
+	// Fuzzy search and its maximum number of results.
+	bool _fuzzy;
+	size_t _fuzzyLimit;
+	// Threads ranking large histories, started on demand.
+	std::unique_ptr<ThreadPool> _pool;
+	// Session owning the browsing and search state, if any.
+	Session *_session;
+	
+	// Number of entries pushed, used as sequence number of the next entry.
+	uint64_t _count;
+	// Number of times all entries have been renumbered.
+	uint64_t _epoch;
+	// Journal of pushed entries, if enabled.
+	std::unique_ptr<Journal> _journal;
+	// Shared history file, if enabled, and entries merged from it.
+	std::unique_ptr<SharedFile> _shared;
+	std::vector<std::string> _merged;
+	// Trigram index of the history entries.
+	Index _index;
+	bool _indexed;
+	
+	// Open-addressing hash table of the sequence numbers of all entries, used
+	// for global deduplication.
+	struct Bucket {
+		uint64_t seq;
+		size_t hash;
+	};
+	static uint64_t constexpr emptyBucket = uint64_t(-1);
+	std::vector<Bucket> _unique;
+	bool _deduplicated;
+	
+#if defined(CONSOLE_METRICS)
+	// Metrics, also updated by saving.
+	mutable HistoryMetrics _metrics;
+#endif
 };
 
 }
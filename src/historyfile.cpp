@@ -0,0 +1,133 @@
+#include "historyfile.h"
+
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+#	include <fstream>
+#	include <iterator>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#	include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#endif
+
+#include <algorithm>
+#include <unordered_set>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//                     Begin namespace <helper functions>                     //
+namespace {
+
+//------------------------------------------------------------------------------
+//--                        End of Line Helper Function                       --
+//------------------------------------------------------------------------------
+// Find the last '\n' or '\r' in [begin, pos), or nullptr if there is none.
+char const *findLastEol(char const *begin, char const *pos) {
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+	__m128i const lf = _mm_set1_epi8('\n');
+	__m128i const cr = _mm_set1_epi8('\r');
+	for(; pos - begin >= 16; pos -= 16) {
+		__m128i chunk = _mm_loadu_si128((__m128i const *)(pos - 16));
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, lf),
+		                                          _mm_cmpeq_epi8(chunk, cr)));
+		if(mask) {
+#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse(&index, mask);
+			return pos - 16 + index;
+#else
+			return pos - 16 + (31 - __builtin_clz(mask));
+#endif
+		}
+	}
+#endif
+	while(pos != begin) {
+		--pos;
+		if(*pos == '\n' || *pos == '\r') {
+			return pos;
+		}
+	}
+	return nullptr;
+}
+
+}
+//                      End namespace <helper functions>                      //
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//--                             Class MappedFile                             --
+//------------------------------------------------------------------------------
+
+MappedFile::MappedFile(std::string const &path)
+: _data(nullptr)
+, _size(0) {
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+	std::ifstream file(path, std::ios::binary);
+	_buffer.assign(std::istreambuf_iterator<char>(file),
+	               std::istreambuf_iterator<char>());
+	_data = _buffer.data();
+	_size = _buffer.size();
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if(fd == -1) {
+		return;
+	}
+	struct stat st;
+	if(fstat(fd, &st) == 0 && st.st_size > 0) {
+		void *data = mmap(nullptr, size_t(st.st_size), PROT_READ,
+		                  MAP_PRIVATE, fd, 0);
+		if(data != MAP_FAILED) {
+			_data = static_cast<char const *>(data);
+			_size = size_t(st.st_size);
+		}
+	}
+	close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if !(defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64))
+	if(_data) {
+		munmap(const_cast<char *>(_data), _size);
+	}
+#endif
+}
+
+//------------------------------------------------------------------------------
+//--                           History File Parsing                           --
+//------------------------------------------------------------------------------
+
+// Retrieve the last maxEntries lines of a history file in order.
+std::vector<std::string_view> tailLines(MappedFile const &file,
+                                        size_t maxEntries, bool distinct) {
+	// Split into lines starting from the end of the file. Treating "\r\n" as
+	// two line endings merely yields an empty line, which is skipped anyway.
+	std::vector<std::string_view> lines;
+	std::unordered_set<std::string_view> seen;
+	for(char const *end = file.end(); end && lines.size() < maxEntries;) {
+		char const *eol = findLastEol(file.begin(), end);
+		char const *begin = eol ? eol + 1 : file.begin();
+		std::string_view line(begin, size_t(end - begin));
+		if(!line.empty() && (lines.empty() || line != lines.back()) &&
+		   (!distinct || seen.insert(line).second)) {
+			lines.push_back(line);
+		}
+		end = eol;
+	}
+	std::reverse(lines.begin(), lines.end());
+	return lines;
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
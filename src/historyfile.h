@@ -0,0 +1,51 @@
+#ifndef CONSOLE_HISTORYFILE_H
+#define CONSOLE_HISTORYFILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                             Class MappedFile                             --
+//------------------------------------------------------------------------------
+// Read-only view of the contents of a file, memory-mapped where supported.
+// A file that cannot be read is viewed as empty.
+class MappedFile {
+	// Not copyable nor assignable.
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+	
+public:
+	MappedFile(std::string const &path);
+	~MappedFile();
+	
+	char const *begin() const { return _data; }
+	char const *end() const { return _data + _size; }
+	size_t size() const { return _size; }
+	
+private:
+	char const *_data;
+	size_t _size;
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+	std::string _buffer;
+#endif
+};
+
+// Retrieve the last maxEntries lines of a history file in order, skipping empty
+// lines and consecutive duplicates. Lines may be terminated by "\n", "\r" or
+// "\r\n". Only the retained tail of the file is parsed.
+// If distinct is set, all but the last occurrence of each line are skipped,
+// so that maxEntries distinct lines are retained for a deduplicated history.
+std::vector<std::string_view> tailLines(MappedFile const &file,
+                                        size_t maxEntries,
+                                        bool distinct = false);
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
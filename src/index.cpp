@@ -0,0 +1,81 @@
+#include "index.h"
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                               Class Index                                --
+//------------------------------------------------------------------------------
+
+// Add the entry with the specified sequence number.
+void Index::insert(uint64_t seq, std::string_view entry) {
+	trigrams(entry);
+	for(uint32_t trigram : _trigrams) {
+		_postings[trigram]._seqs.push_back(seq);
+	}
+}
+
+// Remove the entry with the specified sequence number.
+void Index::erase(uint64_t seq, std::string_view entry) {
+	trigrams(entry);
+	for(uint32_t trigram : _trigrams) {
+		auto it = _postings.find(trigram);
+		if(it == _postings.end()) {
+			continue;
+		}
+		Postings &postings = it->second;
+		if(postings.size() && *postings.begin() == seq) {
+			++postings._start;
+		}
+		// Drop the trigram or reclaim erased space once it dominates.
+		if(!postings.size()) {
+			_postings.erase(it);
+		} else if(postings._start * 2 > postings._seqs.size()) {
+			postings._seqs.erase(postings._seqs.begin(),
+			                     postings._seqs.begin() + postings._start);
+			postings._start = 0;
+		}
+	}
+}
+
+// Retrieve the postings of the least frequent trigram in str.
+Index::Postings const *Index::candidates(std::string_view str) const {
+	static Postings const none;
+	
+	if(str.size() < 3) {
+		return nullptr;
+	}
+	
+	trigrams(str);
+	Postings const *best = nullptr;
+	for(uint32_t trigram : _trigrams) {
+		auto it = _postings.find(trigram);
+		if(it == _postings.end()) {
+			return &none;
+		}
+		if(!best || it->second.size() < best->size()) {
+			best = &it->second;
+		}
+	}
+	return best;
+}
+
+// Collect the distinct trigrams of str into _trigrams.
+void Index::trigrams(std::string_view str) const {
+	_trigrams.clear();
+	for(size_t i = 2; i < str.size(); ++i) {
+		_trigrams.push_back(uint32_t(uint8_t(str[i - 2])) << 16 |
+		                    uint32_t(uint8_t(str[i - 1])) << 8 |
+		                    uint32_t(uint8_t(str[i])));
+	}
+	std::sort(_trigrams.begin(), _trigrams.end());
+	_trigrams.erase(std::unique(_trigrams.begin(), _trigrams.end()),
+	                _trigrams.end());
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
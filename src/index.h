@@ -0,0 +1,65 @@
+#ifndef CONSOLE_INDEX_H
+#define CONSOLE_INDEX_H
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                               Class Index                                --
+//------------------------------------------------------------------------------
+// Trigram inverted index of history entries, identified by increasing sequence
+// numbers. Used to narrow the candidates of a substring search.
+class Index {
+public:
+	// Sorted sequence numbers of the entries containing a trigram.
+	class Postings {
+	public:
+		uint64_t const *begin() const { return _seqs.data() + _start; }
+		uint64_t const *end() const { return _seqs.data() + _seqs.size(); }
+		size_t size() const { return _seqs.size() - _start; }
+		
+	private:
+		friend class Index;
+		
+		std::vector<uint64_t> _seqs;
+		// Number of leading sequence numbers that have been erased.
+		size_t _start = 0;
+	};
+	
+public:
+	// Remove all entries from the index.
+	void clear() { _postings.clear(); }
+	
+	// Add the entry with the specified sequence number, which must be greater
+	// than that of any entry in the index.
+	void insert(uint64_t seq, std::string_view entry);
+	// Remove the entry with the specified sequence number, which must be the
+	// smallest of any entry in the index.
+	void erase(uint64_t seq, std::string_view entry);
+	
+	// Retrieve the postings of the least frequent trigram in str, which are a
+	// superset of the entries containing str.
+	// Returns nullptr if str is too short to be narrowed by the index.
+	Postings const *candidates(std::string_view str) const;
+	
+private:
+	// Collect the distinct trigrams of str into _trigrams.
+	void trigrams(std::string_view str) const;
+	
+private:
+	std::unordered_map<uint32_t, Postings> _postings;
+	// Scratch buffer for the trigrams of an entry.
+	mutable std::vector<uint32_t> _trigrams;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,248 @@
+#include "journal.h"
+#include "historyfile.h"
+
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+#	include <io.h>
+#else
+#	include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//                     Begin namespace <helper functions>                     //
+namespace {
+
+//------------------------------------------------------------------------------
+//--                            File Sync Function                            --
+//------------------------------------------------------------------------------
+// Flush a file and sync it to disk, returning false on failure.
+bool syncFile(std::FILE *file) {
+	if(std::fflush(file) != 0) {
+		return false;
+	}
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+}
+//                      End namespace <helper functions>                      //
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//--                              Class Journal                               --
+//------------------------------------------------------------------------------
+
+// Open the journal at the specified path.
+Journal::Journal(std::string path, size_t maxEntries,
+                 std::chrono::milliseconds interval)
+: _path(std::move(path))
+, _maxEntries(maxEntries)
+, _interval(interval)
+, _file(nullptr)
+, _entries(0)
+, _compactAt(2 * maxEntries)
+, _pendingEntries(0)
+, _syncRequests(0)
+, _syncs(0)
+, _failed(false)
+, _stop(false) {
+	{
+		MappedFile file(_path);
+		_entries = size_t(std::count(file.begin(), file.end(), '\n'));
+	}
+	if(_entries > _compactAt) {
+		_file = compact();
+	}
+	if(!_file) {
+		_file = std::fopen(_path.c_str(), "ab");
+	}
+	if(!_file) {
+		throw std::runtime_error(
+			"Could not open history journal."
+		);
+	}
+	
+	_thread = std::thread(&Journal::run, this);
+}
+
+// Write all pending entries and close the journal.
+Journal::~Journal() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_one();
+	_thread.join();
+	if(_file) {
+		std::fclose(_file);
+	}
+}
+
+// Append the specified entry to the journal.
+void Journal::append(std::string const &entry) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if(_failed) {
+		_failed = false;
+		throw std::runtime_error(
+			"Could not write history journal."
+		);
+	}
+	_pending += entry;
+	_pending += '\n';
+	++_pendingEntries;
+	if(_pending.size() >= batchSize) {
+		_wake.notify_one();
+	}
+}
+
+// Write and sync all pending entries, waiting for completion.
+void Journal::sync() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	uint64_t request = ++_syncRequests;
+	_wake.notify_one();
+	_synced.wait(lock, [&] { return _syncs >= request; });
+	if(_failed) {
+		_failed = false;
+		throw std::runtime_error(
+			"Could not write history journal."
+		);
+	}
+}
+
+// Background thread writing pending entries.
+void Journal::run() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(!_stop) {
+		_wake.wait_for(lock, _interval, [&] {
+			return _stop || _syncs < _syncRequests ||
+			       _pending.size() >= batchSize;
+		});
+		write(lock);
+	}
+	write(lock);
+}
+
+// Write and sync pending entries, compacting the file if required.
+void Journal::write(std::unique_lock<std::mutex> &lock) {
+	uint64_t requests = _syncRequests;
+	std::string pending;
+	pending.swap(_pending);
+	size_t entries = _pendingEntries;
+	_pendingEntries = 0;
+	
+	// Write without holding the lock, so appending never waits for the disk.
+	lock.unlock();
+	bool failed = false;
+	if(!pending.empty()) {
+		// Retry opening a file lost to a failed compaction.
+		if(!_file) {
+			_file = std::fopen(_path.c_str(), "ab");
+		}
+		if(_file) {
+			failed = std::fwrite(pending.data(), 1, pending.size(),
+			                     _file) != pending.size();
+			failed = !syncFile(_file) || failed;
+			failed = std::ferror(_file) != 0 || failed;
+			std::clearerr(_file);
+			_entries += entries;
+		} else {
+			failed = true;
+		}
+		
+		if(_file && _entries > _compactAt) {
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+			// Open files cannot be replaced, so reopen the file if compaction
+			// fails.
+			std::fclose(_file);
+			_file = compact();
+			if(!_file) {
+				_file = std::fopen(_path.c_str(), "ab");
+			}
+#else
+			// Keep appending to the current file if compaction fails.
+			if(std::FILE *file = compact()) {
+				std::fclose(_file);
+				_file = file;
+			}
+#endif
+			// Back off until another maxEntries entries have been written.
+			_compactAt = _entries > _maxEntries ? _entries + _maxEntries :
+			                                      2 * _maxEntries;
+		}
+	}
+	lock.lock();
+	_failed = _failed || failed;
+	
+	// Reuse the buffer for subsequent entries.
+	if(_pending.empty()) {
+		pending.clear();
+		_pending.swap(pending);
+	}
+	
+	_syncs = requests;
+	_synced.notify_all();
+}
+
+// Rewrite the file to contain only the most recent entries.
+std::FILE *Journal::compact() {
+	std::string temp = _path + ".tmp";
+	std::FILE *out = std::fopen(temp.c_str(), "wb");
+	if(!out) {
+		return nullptr;
+	}
+	size_t entries;
+	bool failed = false;
+	{
+		MappedFile file(_path);
+		std::vector<std::string_view> lines = tailLines(file, _maxEntries);
+		for(std::string_view line : lines) {
+			if(std::fwrite(line.data(), 1, line.size(), out) != line.size() ||
+			   std::fputc('\n', out) == EOF) {
+				failed = true;
+				break;
+			}
+		}
+		entries = lines.size();
+	}
+	// Never replace the file with an incompletely written one.
+	failed = failed || !syncFile(out) || std::ferror(out);
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+	// Open files cannot be renamed, so reopen the file once replaced.
+	failed = std::fclose(out) != 0 || failed;
+	out = nullptr;
+#endif
+	std::error_code error;
+	if(failed) {
+		if(out) {
+			std::fclose(out);
+		}
+		std::filesystem::remove(temp, error);
+		return nullptr;
+	}
+	
+	std::filesystem::rename(temp, _path, error);
+	if(error) {
+		if(out) {
+			std::fclose(out);
+		}
+		std::filesystem::remove(temp, error);
+		return nullptr;
+	}
+	_entries = entries;
+	// Keep the rewritten file open for appending.
+	return out ? out : std::fopen(_path.c_str(), "ab");
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
@@ -0,0 +1,88 @@
+#ifndef CONSOLE_JOURNAL_H
+#define CONSOLE_JOURNAL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                              Class Journal                               --
+//------------------------------------------------------------------------------
+// Append-only history file. Entries are buffered and written by a background
+// thread, which syncs them to disk in batches or after an interval, and
+// compacts the file back to the most recent entries once it grows too large.
+class Journal {
+	// Not copyable nor assignable.
+	Journal(Journal const &) = delete;
+	Journal &operator=(Journal const &) = delete;
+	
+public:
+	// Open the journal at the specified path, retaining at least maxEntries
+	// entries and syncing pending entries at least once per interval.
+	Journal(std::string path, size_t maxEntries,
+	        std::chrono::milliseconds interval = std::chrono::seconds(1));
+	// Write all pending entries and close the journal.
+	~Journal();
+	
+	// Append the specified entry to the journal. Throws without appending it if
+	// entries could not be written since the previous sync or append.
+	void append(std::string const &entry);
+	// Write and sync all pending entries, waiting for completion. Throws if
+	// entries could not be written since the previous sync or append.
+	void sync();
+	
+private:
+	// Background thread writing pending entries.
+	void run();
+	// Write and sync pending entries, compacting the file if required.
+	void write(std::unique_lock<std::mutex> &lock);
+	// Rewrite the file to contain only the most recent entries. Returns the
+	// rewritten file opened for appending, or nullptr on failure.
+	std::FILE *compact();
+	
+private:
+	// Number of buffered bytes triggering an immediate write.
+	static size_t constexpr batchSize = 64 * 1024;
+	
+	std::string const _path;
+	size_t const _maxEntries;
+	std::chrono::milliseconds const _interval;
+	
+	// File appended to, only accessed by the background thread.
+	std::FILE *_file;
+	// Approximate number of entries in the file.
+	size_t _entries;
+	// Number of entries in the file triggering compaction, raised while
+	// compaction fails so that it is not retried on every batch.
+	size_t _compactAt;
+	
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _synced;
+	// Entries waiting to be written.
+	std::string _pending;
+	// Number of entries in _pending.
+	size_t _pendingEntries;
+	// Number of requested and completed syncs.
+	uint64_t _syncRequests;
+	uint64_t _syncs;
+	// Indicator of entries dropped since the previous sync or append.
+	bool _failed;
+	bool _stop;
+	
+	std::thread _thread;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,104 @@
+#include "linebuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                            Class LineBuffer                              --
+//------------------------------------------------------------------------------
+
+LineBuffer::LineBuffer()
+: _buffer(64)
+, _gapBegin(0)
+, _gapEnd(_buffer.size())
+, _dirty(0) { }
+
+// Insert the specified string at the specified position.
+void LineBuffer::insert(size_t pos, std::string_view str) {
+	reserveGap(str.size());
+	moveGap(pos);
+	_dirty = std::min(_dirty, pos);
+	std::memcpy(_buffer.data() + _gapBegin, str.data(), str.size());
+	_gapBegin += str.size();
+}
+
+// Erase n characters starting at the specified position.
+void LineBuffer::erase(size_t pos, size_t n) {
+	moveGap(pos);
+	_gapEnd += std::min(n, _buffer.size() - _gapEnd);
+	_dirty = std::min(_dirty, pos);
+}
+
+// Replace the line with the specified string.
+void LineBuffer::assign(std::string_view str) {
+	// Copy a view of the line itself before overwriting it.
+	if(str.data() >= _buffer.data() &&
+	   str.data() < _buffer.data() + _buffer.size()) {
+		std::string copy(str);
+		assign(copy);
+		return;
+	}
+	clear();
+	insert(0, str);
+}
+
+// Erase the complete line.
+void LineBuffer::clear() {
+	_gapBegin = 0;
+	_gapEnd = _buffer.size();
+	_dirty = 0;
+}
+
+// Retrieve a contiguous view of the line, moving the gap to its end.
+std::string_view LineBuffer::view() {
+	moveGap(size());
+	return { _buffer.data(), _gapBegin };
+}
+
+// Append the line from the specified position onwards to the specified string.
+void LineBuffer::appendTo(std::string &str, size_t pos) const {
+	if(pos < _gapBegin) {
+		str.append(_buffer.data() + pos, _gapBegin - pos);
+		pos = _gapBegin;
+	}
+	size_t offset = _gapEnd + (pos - _gapBegin);
+	str.append(_buffer.data() + offset, _buffer.size() - offset);
+}
+
+// Move the gap to the specified position.
+void LineBuffer::moveGap(size_t pos) {
+	if(pos < _gapBegin) {
+		size_t n = _gapBegin - pos;
+		std::memmove(_buffer.data() + _gapEnd - n, _buffer.data() + pos, n);
+		_gapBegin -= n;
+		_gapEnd -= n;
+	} else if(pos > _gapBegin) {
+		size_t n = pos - _gapBegin;
+		std::memmove(_buffer.data() + _gapBegin, _buffer.data() + _gapEnd, n);
+		_gapBegin += n;
+		_gapEnd += n;
+	}
+}
+
+// Grow the gap to hold at least n characters.
+void LineBuffer::reserveGap(size_t n) {
+	size_t gap = _gapEnd - _gapBegin;
+	if(gap >= n) {
+		return;
+	}
+	size_t capacity = std::max(_buffer.size() * 2, _buffer.size() - gap + n);
+	size_t tail = _buffer.size() - _gapEnd;
+	std::vector<char> buffer(capacity);
+	std::memcpy(buffer.data(), _buffer.data(), _gapBegin);
+	std::memcpy(buffer.data() + capacity - tail, _buffer.data() + _gapEnd, tail);
+	_gapEnd = capacity - tail;
+	_buffer.swap(buffer);
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
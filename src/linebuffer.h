@@ -0,0 +1,75 @@
+#ifndef CONSOLE_LINEBUFFER_H
+#define CONSOLE_LINEBUFFER_H
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                            Class LineBuffer                              --
+//------------------------------------------------------------------------------
+// Gap buffer holding the command line being edited. The gap follows the edit
+// position, so inserting and erasing at the cursor take amortized constant time
+// regardless of the length of the line.
+class LineBuffer {
+public:
+	LineBuffer();
+	
+	// Check if the line is empty.
+	bool empty() const { return !size(); }
+	// Retrieve the length of the line.
+	size_t size() const { return _buffer.size() - (_gapEnd - _gapBegin); }
+	// Retrieve the number of characters allocated, including the gap.
+	size_t capacity() const { return _buffer.size(); }
+	
+	// Retrieve the character at the specified position.
+	char operator[](size_t pos) const {
+		return _buffer[pos < _gapBegin ? pos : pos + (_gapEnd - _gapBegin)];
+	}
+	
+	// Insert the specified string at the specified position.
+	void insert(size_t pos, std::string_view str);
+	// Erase n characters starting at the specified position.
+	void erase(size_t pos, size_t n);
+	// Replace the line with the specified string.
+	void assign(std::string_view str);
+	// Erase the complete line.
+	void clear();
+	
+	// Retrieve a contiguous view of the line, moving the gap to its end.
+	// The view is invalidated by any modification of the line.
+	std::string_view view();
+	// Append the line from the specified position onwards to the specified
+	// string without moving the gap.
+	void appendTo(std::string &str, size_t pos = 0) const;
+	
+	// Retrieve the lowest position modified since the line was last marked
+	// clean, or the length of the line if it is unmodified.
+	size_t dirty() const { return std::min(_dirty, size()); }
+	// Mark the line as unmodified.
+	void clean() { _dirty = size(); }
+	
+private:
+	// Move the gap to the specified position.
+	void moveGap(size_t pos);
+	// Grow the gap to hold at least n characters.
+	void reserveGap(size_t n);
+	
+private:
+	std::vector<char> _buffer;
+	size_t _gapBegin;
+	size_t _gapEnd;
+	// Lowest position modified since the line was last marked clean.
+	size_t _dirty;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -1,28 +1,80 @@
 #include "console.h"
+#if defined(__linux__)
+#	include "server.h"
+#endif
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 class MyConsole : public Console::Console {
 public:
 	MyConsole() {
 		loadHistory(".history");
+		journalHistory(".history");
+		addVocabulary();
 	}
-	
-	~MyConsole() {
-		saveHistory(".history");
+	// Construct a console of a remote session sharing the specified history.
+	MyConsole(std::shared_ptr<::Console::History> history,
+	          ::Console::Output &output)
+	: Console(std::move(history), output, -1, false)
+	, _remote(true) {
+		addVocabulary();
 	}
 	
 private:
 	// Called when a command has been entered.
 	virtual void onCommand(std::string command) override {
-		std::cout << command << std::endl;
-		addHistory(std::move(command));
+		if(_remote) {
+			print(command);
+		} else {
+			std::cout << command << std::endl;
+		}
+		try {
+			addHistory(std::move(command));
+		} catch(std::exception const &e) {
+			print(e.what());
+		}
+	}
+	
+	// Add the words completed by default.
+	void addVocabulary() {
+		for(char const *word : { "help", "history", "hosts", "quit" }) {
+			vocabulary().insert(word);
+		}
 	}
+	
+private:
+	bool _remote = false;
 };
 
-int main() try {
+int main(int argc, char **argv) try {
+#if defined(__linux__)
+	// Serve sessions sharing one history with --unix PATH or --tcp PORT.
+	if(argc == 3 && (!std::strcmp(argv[1], "--unix") ||
+	                 !std::strcmp(argv[1], "--tcp"))) {
+		auto history = std::make_shared<Console::History>();
+		history->load(".history");
+		history->journal(".history");
+		
+		Console::Server server([&](Console::Output &output) {
+			return std::make_unique<MyConsole>(history, output);
+		});
+		if(!std::strcmp(argv[1], "--unix")) {
+			server.listenUnix(argv[2]);
+		} else {
+			server.listenTcp(uint16_t(std::atoi(argv[2])));
+		}
+		server.run();
+		return 0;
+	}
+#else
+	(void)argc;
+	(void)argv;
+#endif
+	
 	MyConsole console;
-	while(console.putc(getchar()));
+	while(console.poll());
 	return 0;
 } catch(std::exception const &e) {
 	std::cerr << "Unexpected: " << e.what() << std::endl;
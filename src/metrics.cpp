@@ -0,0 +1,138 @@
+#include "metrics.h"
+
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#endif
+
+#include <limits>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                             Class Histogram                              --
+//------------------------------------------------------------------------------
+
+Histogram::Histogram() {
+	reset();
+}
+
+// Add all values recorded by the specified histogram.
+void Histogram::merge(Histogram const &other) {
+	for(size_t i = 0; i < bucketCount; ++i) {
+		_buckets[i] += other._buckets[i];
+	}
+	_count += other._count;
+	_sum += other._sum;
+	if(other._min < _min) {
+		_min = other._min;
+	}
+	if(other._max > _max) {
+		_max = other._max;
+	}
+}
+
+// Remove all values.
+void Histogram::reset() {
+	_buckets.fill(0);
+	_count = 0;
+	_sum = 0;
+	_min = std::numeric_limits<uint64_t>::max();
+	_max = 0;
+}
+
+// Retrieve the value below which the fraction p of the values lie.
+uint64_t Histogram::percentile(double p) const {
+	if(!_count) {
+		return 0;
+	}
+	uint64_t rank = uint64_t(p * double(_count));
+	if(rank >= _count) {
+		rank = _count - 1;
+	}
+	uint64_t seen = 0;
+	for(size_t i = 0; i < bucketCount; ++i) {
+		seen += _buckets[i];
+		if(seen > rank) {
+			uint64_t value = upper(i);
+			return value < _max ? value : _max;
+		}
+	}
+	return _max;
+}
+
+// Write a summary of the values, divided by scale and followed by unit.
+void Histogram::dump(std::ostream &os, double scale, char const *unit) const {
+	os << "count " << _count;
+	if(_count) {
+		os << ", mean " << mean() / scale << unit
+		   << ", p50 " << percentile(0.50) / scale << unit
+		   << ", p90 " << percentile(0.90) / scale << unit
+		   << ", p99 " << percentile(0.99) / scale << unit
+		   << ", max " << max() / scale << unit;
+	}
+}
+
+// Retrieve the largest value of the specified bucket.
+uint64_t Histogram::upper(size_t index) {
+	if(index < subBuckets) {
+		return index;
+	}
+	unsigned exponent = unsigned(index / subBuckets) + subBits - 1;
+	uint64_t sub = index % subBuckets + subBuckets;
+	unsigned shift = exponent - subBits;
+	return (sub << shift) + ((uint64_t(1) << shift) - 1);
+}
+
+// Count the leading zero bits of a non-zero value.
+unsigned Histogram::leadingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return 63 - unsigned(index);
+#else
+	return unsigned(__builtin_clzll(value));
+#endif
+}
+
+//------------------------------------------------------------------------------
+//--                             Metric Snapshots                             --
+//------------------------------------------------------------------------------
+
+// Write all metrics in readable form.
+void HistoryMetrics::dump(std::ostream &os) const {
+	os << "history searches: " << searches << ", entries visited " << visited
+	   << "\n  time: ";
+	searchTime.dump(os, 1e3, "us");
+	os << "\n  visited: ";
+	searchVisited.dump(os);
+	os << "\nhistory load: " << loadedEntries << " entries\n  time: ";
+	loadTime.dump(os, 1e6, "ms");
+	os << "\nhistory save: " << savedEntries << " entries\n  time: ";
+	saveTime.dump(os, 1e6, "ms");
+	os << "\nhistory allocations: " << allocations << '\n';
+}
+
+// Write all metrics in readable form.
+void ConsoleMetrics::dump(std::ostream &os) const {
+	if(!enabled) {
+		os << "metrics disabled\n";
+		return;
+	}
+	os << "input: " << inputs << " chunks, " << inputBytes << " bytes, "
+	   << sequences << " escape sequences\n  time: ";
+	inputTime.dump(os, 1e3, "us");
+	os << "\nrender: " << renders << " renders, " << renderedBytes
+	   << " bytes\n  time: ";
+	renderTime.dump(os, 1e3, "us");
+	os << "\nwrite: " << writes << " writes, " << writtenBytes
+	   << " bytes\n  time: ";
+	writeTime.dump(os, 1e3, "us");
+	os << "\nallocations: " << allocations << '\n';
+	history.dump(os);
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
@@ -0,0 +1,168 @@
+#ifndef CONSOLE_METRICS_H
+#define CONSOLE_METRICS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Instrumentation of the hot paths is only compiled in if CONSOLE_METRICS is
+// defined. Otherwise CONSOLE_METRIC expands to nothing and metrics snapshots
+// remain empty.
+#if defined(CONSOLE_METRICS)
+#	define CONSOLE_METRIC(...) __VA_ARGS__
+#else
+#	define CONSOLE_METRIC(...)
+#endif
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                             Class Histogram                              --
+//------------------------------------------------------------------------------
+// Histogram of non-negative values in log-linear buckets: each power of two is
+// split into 16 buckets, bounding the relative error of percentiles to 1/16
+// over the complete 64 bit range in less than 8 KiB.
+class Histogram {
+public:
+	Histogram();
+	
+	// Record the specified value.
+	void record(uint64_t value) {
+		++_buckets[index(value)];
+		++_count;
+		_sum += value;
+		if(value < _min) {
+			_min = value;
+		}
+		if(value > _max) {
+			_max = value;
+		}
+	}
+	// Add all values recorded by the specified histogram.
+	void merge(Histogram const &other);
+	// Remove all values.
+	void reset();
+	
+	// Retrieve the number of values recorded.
+	uint64_t count() const { return _count; }
+	// Retrieve the smallest, largest and mean value, or 0 if there are none.
+	uint64_t min() const { return _count ? _min : 0; }
+	uint64_t max() const { return _max; }
+	double mean() const { return _count ? double(_sum) / _count : 0; }
+	// Retrieve the value below which the fraction p of the values lie.
+	uint64_t percentile(double p) const;
+	
+	// Write a summary of the values, divided by scale and followed by unit.
+	void dump(std::ostream &os, double scale = 1, char const *unit = "") const;
+	
+private:
+	// Retrieve the bucket of the specified value.
+	static size_t index(uint64_t value) {
+		if(value < subBuckets) {
+			return size_t(value);
+		}
+		unsigned exponent = 63 - leadingZeros(value);
+		size_t sub = size_t(value >> (exponent - subBits)) - subBuckets;
+		return subBuckets * (exponent - subBits + 1) + sub;
+	}
+	// Retrieve the largest value of the specified bucket.
+	static uint64_t upper(size_t index);
+	// Count the leading zero bits of a non-zero value.
+	static unsigned leadingZeros(uint64_t value);
+	
+private:
+	static unsigned constexpr subBits = 4;
+	static size_t constexpr subBuckets = size_t(1) << subBits;
+	static size_t constexpr bucketCount = subBuckets * (64 - subBits + 1);
+	
+	std::array<uint64_t, bucketCount> _buckets;
+	uint64_t _count;
+	uint64_t _sum;
+	uint64_t _min;
+	uint64_t _max;
+};
+
+//------------------------------------------------------------------------------
+//--                            Class ScopedTimer                             --
+//------------------------------------------------------------------------------
+// Records the nanoseconds between its construction and destruction.
+class ScopedTimer {
+public:
+	explicit ScopedTimer(Histogram &histogram)
+	: _histogram(histogram)
+	, _start(std::chrono::steady_clock::now()) { }
+	
+	~ScopedTimer() {
+		_histogram.record(uint64_t(std::chrono::duration_cast<
+			std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start)
+			.count()));
+	}
+	
+private:
+	Histogram &_histogram;
+	std::chrono::steady_clock::time_point _start;
+};
+
+//------------------------------------------------------------------------------
+//--                             Metric Snapshots                             --
+//------------------------------------------------------------------------------
+// Metrics of a history. Durations are in nanoseconds.
+struct HistoryMetrics {
+	// Searches, including every refinement of the search string.
+	uint64_t searches = 0;
+	Histogram searchTime;
+	// Entries examined by searches, in total and per search.
+	uint64_t visited = 0;
+	Histogram searchVisited;
+	// History file loads and saves, and the number of entries transferred.
+	Histogram loadTime;
+	Histogram saveTime;
+	uint64_t loadedEntries = 0;
+	uint64_t savedEntries = 0;
+	// Growths of the entry storage.
+	uint64_t allocations = 0;
+	
+	// Write all metrics in readable form.
+	void dump(std::ostream &os) const;
+};
+
+// Metrics of a console and its history. Durations are in nanoseconds.
+struct ConsoleMetrics {
+	// Indicator that metrics have been compiled in.
+#if defined(CONSOLE_METRICS)
+	static bool constexpr enabled = true;
+#else
+	static bool constexpr enabled = false;
+#endif
+	
+	// Chunks of input fed, with their processing time, and input bytes.
+	uint64_t inputs = 0;
+	Histogram inputTime;
+	uint64_t inputBytes = 0;
+	// Escape sequences decoded from the input.
+	uint64_t sequences = 0;
+	// Renders of the command prompt, with their duration, and bytes rendered.
+	uint64_t renders = 0;
+	Histogram renderTime;
+	uint64_t renderedBytes = 0;
+	// Writes to the output, with their duration, and bytes written.
+	uint64_t writes = 0;
+	Histogram writeTime;
+	uint64_t writtenBytes = 0;
+	// Growths of the frame, display and command line buffers.
+	uint64_t allocations = 0;
+	// Metrics of the command history.
+	HistoryMetrics history;
+	
+	// Write all metrics in readable form.
+	void dump(std::ostream &os) const;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,84 @@
+#include "output.h"
+
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+#	include <windows.h>
+#	include <io.h>
+#else
+#	include <poll.h>
+#	include <sys/ioctl.h>
+#	include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                              Class FdOutput                              --
+//------------------------------------------------------------------------------
+
+// Write the specified bytes to the file descriptor.
+void FdOutput::write(char const *data, size_t size) {
+	while(size > 0) {
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+		int n = _write(_fd, data, (unsigned)size);
+#else
+		ssize_t n = ::write(_fd, data, size);
+#endif
+		if(n < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+#if !(defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64))
+			// Wait for a non-blocking descriptor to become writable.
+			if(errno == EAGAIN || errno == EWOULDBLOCK) {
+				pollfd fd { _fd, POLLOUT, 0 };
+				::poll(&fd, 1, -1);
+				continue;
+			}
+#endif
+			throw std::runtime_error(
+				"Could not write to output."
+			);
+		}
+		data += n;
+		size -= n;
+	}
+}
+
+// Retrieve the number of columns of the terminal of the file descriptor.
+size_t FdOutput::columns() const {
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+	CONSOLE_SCREEN_BUFFER_INFO info;
+	HANDLE handle = (HANDLE)_get_osfhandle(_fd);
+	if(handle == INVALID_HANDLE_VALUE ||
+	   !GetConsoleScreenBufferInfo(handle, &info)) {
+		return 0;
+	}
+	return size_t(info.srWindow.Right - info.srWindow.Left + 1);
+#else
+	winsize size;
+	if(ioctl(_fd, TIOCGWINSZ, &size) == -1) {
+		return 0;
+	}
+	return size.ws_col;
+#endif
+}
+
+// Retrieve an output writing to the standard output.
+Output &standardOutput() {
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+	static FdOutput output(_fileno(stdout));
+#else
+	static FdOutput output(STDOUT_FILENO);
+#endif
+	return output;
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
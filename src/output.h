@@ -0,0 +1,54 @@
+#ifndef CONSOLE_OUTPUT_H
+#define CONSOLE_OUTPUT_H
+
+#include <cstddef>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                               Class Output                               --
+//------------------------------------------------------------------------------
+// Sink for the bytes emitted by a console.
+class Output {
+public:
+	virtual ~Output() = default;
+	
+	// Write the specified bytes to the output.
+	virtual void write(char const *data, size_t size) = 0;
+	// Retrieve the number of columns of the terminal displaying the output, or
+	// 0 if it is unknown.
+	virtual size_t columns() const { return 0; }
+};
+
+//------------------------------------------------------------------------------
+//--                              Class FdOutput                              --
+//------------------------------------------------------------------------------
+// Output writing directly to a file descriptor.
+class FdOutput : public Output {
+public:
+	// Construct an output writing to the specified file descriptor.
+	FdOutput(int fd) : _fd(fd) { }
+	
+	// Retrieve the file descriptor written to.
+	int fd() const { return _fd; }
+	
+	// Write the specified bytes to the file descriptor.
+	virtual void write(char const *data, size_t size) override;
+	// Retrieve the number of columns of the terminal of the file descriptor, or
+	// 0 if it is not a terminal.
+	virtual size_t columns() const override;
+	
+private:
+	int _fd;
+};
+
+// Retrieve an output writing to the standard output.
+Output &standardOutput();
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
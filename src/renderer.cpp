@@ -0,0 +1,157 @@
+#include "renderer.h"
+#include "csi.h"
+#include "utf8.h"
+#include "width.h"
+
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                              Class Renderer                              --
+//------------------------------------------------------------------------------
+
+// Construct a renderer for an unknown screen state.
+Renderer::Renderer()
+: _column(0)
+, _length(0)
+, _valid(false)
+, _frameBytes(0)
+, _totalBytes(0) { }
+
+// Render the specified line with the cursor at the specified byte offset.
+void Renderer::render(std::string &frame, std::string const &line,
+                      size_t cursor, size_t unchanged) {
+	size_t start = frame.size();
+	
+	// Find the first differing cluster, skipping the known unchanged bytes.
+	size_t diff = 0;
+	if(_valid) {
+		size_t size = std::min(line.size(), _line.size());
+		diff = std::min(unchanged, size);
+		while(diff < size && line[diff] == _line[diff]) {
+			++diff;
+		}
+		// Back up to a cluster boundary of both lines.
+		size_t aligned;
+		while((aligned = clusterStart(_line, clusterStart(line, diff))) != diff) {
+			diff = aligned;
+		}
+	}
+	
+	size_t oldLength = _length;
+	updateColumns(line, diff);
+	size_t length = _length;
+	size_t column = _columns[cursor];
+	
+	if(!_valid) {
+		// Repaint the complete line.
+		frame += CSI::clear;
+		frame += CSI::green;
+		frame += line;
+		frame += CSI::resetAttributes;
+		moveCursor(frame, length, column);
+	} else {
+		size_t common = _columns[diff];
+		if(diff < line.size()) {
+			// Overwrite or append the differing tail.
+			moveCursor(frame, _column, common);
+			frame += CSI::green;
+			frame.append(line, diff, std::string::npos);
+			frame += CSI::resetAttributes;
+			if(oldLength > length) {
+				frame += CSI::clearToEnd;
+			}
+			moveCursor(frame, length, column);
+		} else if(diff < _line.size()) {
+			// Erase the remainder of the previous line.
+			moveCursor(frame, _column, common);
+			frame += CSI::clearToEnd;
+			moveCursor(frame, common, column);
+		} else {
+			moveCursor(frame, _column, column);
+		}
+	}
+	
+	// Replace only the differing tail of the line.
+	_line.replace(diff, std::string::npos, line, diff, std::string::npos);
+	_column = column;
+	_valid = true;
+	
+	_frameBytes = frame.size() - start;
+	_totalBytes += _frameBytes;
+}
+
+// Clear the line on screen, appending the required output to frame.
+void Renderer::clear(std::string &frame) {
+	frame += CSI::clear;
+	_line.clear();
+	_column = 0;
+	_length = 0;
+	_valid = true;
+	
+	_totalBytes += std::char_traits<char>::length(CSI::clear);
+}
+
+// Recompute the cached columns of line from byte offset pos onwards.
+void Renderer::updateColumns(std::string const &line, size_t pos) {
+	_columns.resize(line.size() + 1);
+	size_t column = _columns[pos];
+	while(pos < line.size()) {
+		// Printable ascii octets are single column clusters, except for the
+		// last of a run, which a following codepoint may extend.
+		size_t run = Utf8::printable(line.data() + pos, line.size() - pos);
+		if(pos + run < line.size() && run) {
+			--run;
+		}
+		for(size_t end = pos + run; pos < end; ++pos) {
+			_columns[pos] = column++;
+		}
+		if(pos == line.size()) {
+			break;
+		}
+		
+		size_t next = Width::posNext(line, pos);
+		std::fill(_columns.begin() + pos, _columns.begin() + next, column);
+		column += Width::columns(line, pos, next);
+		pos = next;
+	}
+	_columns[pos] = column;
+	_length = column;
+}
+
+// Start of the cluster containing byte offset pos.
+size_t Renderer::clusterStart(std::string const &line, size_t pos) {
+	if(!pos || pos >= line.size()) {
+		return pos;
+	}
+	return Width::posPrev(line, pos + 1);
+}
+
+// Append cursor movement from column from to column to onto frame.
+void Renderer::moveCursor(std::string &frame, size_t from, size_t to) {
+	if(to < from) {
+		size_t n = from - to;
+		// Use a carriage return if it is shorter than moving left.
+		if(to == 0 && n > 1) {
+			frame += '\r';
+		} else if(n == 1) {
+			frame += CSI::left;
+		} else {
+			frame += "\033[" + std::to_string(n) + "D";
+		}
+	} else if(to > from) {
+		size_t n = to - from;
+		if(n == 1) {
+			frame += CSI::right;
+		} else {
+			frame += "\033[" + std::to_string(n) + "C";
+		}
+	}
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
@@ -0,0 +1,69 @@
+#ifndef CONSOLE_RENDERER_H
+#define CONSOLE_RENDERER_H
+
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                              Class Renderer                              --
+//------------------------------------------------------------------------------
+// Renders a single line of text with a cursor, remembering what is currently on
+// screen and emitting only the escape sequences needed to reach the new state.
+class Renderer {
+public:
+	// Construct a renderer for an unknown screen state.
+	Renderer();
+	
+	// Render the specified line with the cursor at the specified byte offset,
+	// appending the required output to frame. The first unchanged bytes of the
+	// line are known to equal the previous render and are not compared.
+	void render(std::string &frame, std::string const &line, size_t cursor,
+	            size_t unchanged = 0);
+	
+	// Clear the line on screen, appending the required output to frame.
+	void clear(std::string &frame);
+	
+	// Forget the screen contents, forcing the next render to repaint the line.
+	// Must be called whenever other output is written to the terminal.
+	void invalidate() { _valid = false; }
+	
+	// Retrieve the number of bytes emitted by the most recent render.
+	size_t frameBytes() const { return _frameBytes; }
+	// Retrieve the total number of bytes emitted by all renders.
+	size_t totalBytes() const { return _totalBytes; }
+	
+private:
+	// Append cursor movement from column from to column to onto frame.
+	static void moveCursor(std::string &frame, size_t from, size_t to);
+	// Recompute the cached columns of line from byte offset pos onwards.
+	void updateColumns(std::string const &line, size_t pos);
+	// Start of the cluster containing byte offset pos.
+	static size_t clusterStart(std::string const &line, size_t pos);
+	
+private:
+	// The line currently on screen.
+	std::string _line;
+	// Column of the cursor on screen.
+	size_t _column;
+	// Number of columns occupied by _line.
+	size_t _length;
+	// Column at each byte offset of _line, kept so that a render only measures
+	// the changed tail.
+	std::vector<size_t> _columns;
+	// Indicator that _line and _column reflect the screen contents.
+	bool _valid;
+	
+	// Byte counters for measuring render cost.
+	size_t _frameBytes;
+	size_t _totalBytes;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,555 @@
+#include "server.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//                     Begin namespace <helper functions>                     //
+namespace {
+
+// Maximum number of output bytes buffered for a client before it is
+// disconnected.
+size_t constexpr maxPending = 1024 * 1024;
+
+// Interval of retrying to accept connections while out of descriptors, which
+// may be freed by other than the sessions of the server.
+std::chrono::milliseconds constexpr acceptRetry(100);
+
+//------------------------------------------------------------------------------
+//--                             Telnet Protocol                              --
+//------------------------------------------------------------------------------
+namespace Telnet {
+	unsigned char const SE   = 240;
+	unsigned char const IP   = 244;
+	unsigned char const SB   = 250;
+	unsigned char const WILL = 251;
+	unsigned char const DONT = 254;
+	unsigned char const IAC  = 255;
+	
+	unsigned char const ECHO = 1;
+	unsigned char const SUPPRESS_GO_AHEAD = 3;
+	
+	// State of parsing commands out of the input.
+	enum State { DATA, CR, COMMAND, OPTION, SUBNEGOTIATION, SUBNEGOTIATION_IAC };
+	
+	// Remove telnet commands from the specified input in place, keeping
+	// interrupts as Ctrl-C. Returns the size of the remaining data.
+	size_t filter(State &state, char *data, size_t size) {
+		size_t out = 0;
+		for(size_t i = 0; i < size; ++i) {
+			unsigned char c = (unsigned char)data[i];
+			switch(state) {
+			case CR:
+				state = DATA;
+				// Drop the NUL of CR NUL.
+				if(!c) {
+					break;
+				}
+				goto DATA; // [[fallthrough]]
+			case DATA: DATA:
+				if(c == IAC) {
+					state = COMMAND;
+				} else {
+					data[out++] = char(c);
+					if(c == '\r') {
+						state = CR;
+					}
+				}
+				break;
+			case COMMAND:
+				state = DATA;
+				if(c == IAC) {
+					data[out++] = char(c);
+				} else if(c == IP) {
+					data[out++] = 0x03;
+				} else if(c == SB) {
+					state = SUBNEGOTIATION;
+				} else if(c >= WILL && c <= DONT) {
+					state = OPTION;
+				}
+				break;
+			case OPTION:
+				state = DATA;
+				break;
+			case SUBNEGOTIATION:
+				if(c == IAC) {
+					state = SUBNEGOTIATION_IAC;
+				}
+				break;
+			case SUBNEGOTIATION_IAC:
+				state = c == SE ? DATA : SUBNEGOTIATION;
+				break;
+			}
+		}
+		return out;
+	}
+}
+
+//------------------------------------------------------------------------------
+//--                          Socket Helper Function                          --
+//------------------------------------------------------------------------------
+// Create a non-blocking socket.
+int createSocket(int domain) {
+	int fd = socket(domain, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(fd == -1) {
+		throw std::runtime_error(
+			"Could not create socket."
+		);
+	}
+	return fd;
+}
+
+}
+//                      End namespace <helper functions>                      //
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//--                              Struct Session                              --
+//------------------------------------------------------------------------------
+struct Server::Session {
+	Session(int fd, bool telnet)
+	: output(telnet)
+	, input { Source::INPUT, fd, this, telnet }
+	, messages { Source::MESSAGES, -1, this, telnet }
+	, state(Telnet::DATA)
+	, blocked(false)
+	, closed(false) { }
+	
+	~Session() {
+		::close(input.fd);
+	}
+	
+	// Output of the console, buffered until the client accepts it.
+	SessionOutput output;
+	std::unique_ptr<Console> console;
+	// Sources of client input and of messages printed to the console.
+	Source input;
+	Source messages;
+	// State of parsing telnet commands.
+	Telnet::State state;
+	// Indicator of waiting for the client to accept output.
+	bool blocked;
+	// Indicator of a session closed while processing events.
+	bool closed;
+};
+
+//------------------------------------------------------------------------------
+//--                           Class SessionOutput                            --
+//------------------------------------------------------------------------------
+
+// Append the specified bytes, translating new-lines to CR LF.
+void Server::SessionOutput::write(char const *data, size_t size) {
+	// Compact the buffer once more has been sent than is pending.
+	if(_offset > _buffer.size() - _offset) {
+		_buffer.erase(0, _offset);
+		_offset = 0;
+	}
+	char const *end = data + size;
+	while(data < end) {
+		char const *special = data;
+		while(special < end && *special != '\n' &&
+		      (!_telnet || (unsigned char)*special != Telnet::IAC)) {
+			++special;
+		}
+		_buffer.append(data, special);
+		if(special == end) {
+			break;
+		}
+		// Escape data bytes that would start a telnet command.
+		_buffer += *special == '\n' ? "\r\n" : "\xff\xff";
+		data = special + 1;
+	}
+}
+
+// Write as many pending bytes as possible to the specified file descriptor.
+bool Server::SessionOutput::send(int fd) {
+	while(_offset < _buffer.size()) {
+		ssize_t n = ::send(fd, _buffer.data() + _offset,
+		                   _buffer.size() - _offset, MSG_NOSIGNAL);
+		if(n >= 0) {
+			_offset += n;
+		} else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+			return true;
+		} else if(errno != EINTR) {
+			return false;
+		}
+	}
+	_buffer.clear();
+	_offset = 0;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//--                              Class Server                                --
+//------------------------------------------------------------------------------
+
+// Construct a server creating consoles with the specified factory.
+Server::Server(Factory factory)
+: _factory(std::move(factory))
+, _epoll(epoll_create1(EPOLL_CLOEXEC))
+, _wake { Source::WAKE, -1, nullptr, false }
+, _stopped(false)
+, _accepting(true) {
+	if(_epoll == -1) {
+		throw std::runtime_error(
+			"Could not create epoll instance."
+		);
+	}
+	_wake.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(_wake.fd == -1) {
+		::close(_epoll);
+		throw std::runtime_error(
+			"Could not create eventfd."
+		);
+	}
+	watch(_wake, EPOLLIN);
+}
+
+// Disconnect all sessions and stop listening.
+Server::~Server() {
+	// Destroy consoles before closing their sockets.
+	_sessions.clear();
+	for(auto const &listener : _listeners) {
+		::close(listener->fd);
+	}
+	if(!_unixPath.empty()) {
+		unlink(_unixPath.c_str());
+	}
+	::close(_wake.fd);
+	::close(_epoll);
+}
+
+// Accept sessions on the Unix domain socket at the specified path.
+void Server::listenUnix(std::string const &path) {
+	sockaddr_un address {};
+	if(path.size() >= sizeof(address.sun_path)) {
+		throw std::runtime_error(
+			"Socket path is too long."
+		);
+	}
+	address.sun_family = AF_UNIX;
+	std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+	
+	int fd = createSocket(AF_UNIX);
+	unlink(path.c_str());
+	if(bind(fd, (sockaddr *)&address, sizeof(address)) == -1) {
+		::close(fd);
+		throw std::runtime_error(
+			"Could not bind socket."
+		);
+	}
+	listen(fd, false);
+	_unixPath = path;
+}
+
+// Accept telnet sessions on the specified TCP port and IPv4 address.
+void Server::listenTcp(uint16_t port, std::string const &address) {
+	sockaddr_in ip {};
+	ip.sin_family = AF_INET;
+	ip.sin_port = htons(port);
+	if(inet_pton(AF_INET, address.c_str(), &ip.sin_addr) != 1) {
+		throw std::runtime_error(
+			"Invalid IPv4 address."
+		);
+	}
+	
+	int fd = createSocket(AF_INET);
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if(bind(fd, (sockaddr *)&ip, sizeof(ip)) == -1) {
+		::close(fd);
+		throw std::runtime_error(
+			"Could not bind socket."
+		);
+	}
+	listen(fd, true);
+}
+
+// Wait up to timeout milliseconds for events and process them.
+bool Server::poll(int timeout) {
+	if(_stopped) {
+		return false;
+	}
+	
+	// Wake up to retry accepting connections, rounding up so as not to wake
+	// before the retry is due.
+	if(!_accepting) {
+		auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+			_pausedAt + acceptRetry - std::chrono::steady_clock::now()
+		).count();
+		remaining = remaining > 0 ? (remaining + 999) / 1000 : 0;
+		if(timeout < 0 || timeout > remaining) {
+			timeout = int(remaining);
+		}
+	}
+	
+	epoll_event events[64];
+	int n = epoll_wait(_epoll, events, 64, timeout);
+	if(n == -1) {
+		if(errno == EINTR) {
+			return true;
+		}
+		throw std::runtime_error(
+			"Could not wait for events."
+		);
+	}
+	
+	for(int i = 0; i < n; ++i) {
+		Source &source = *(Source *)events[i].data.ptr;
+		switch(source.kind) {
+		case Source::WAKE:
+			break;
+		case Source::LISTENER:
+			accept(source);
+			break;
+		case Source::INPUT:
+			if(source.session->closed) {
+				break;
+			}
+			if(events[i].events & EPOLLOUT) {
+				send(*source.session);
+			}
+			if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+				receive(*source.session);
+			}
+			break;
+		case Source::MESSAGES:
+			if(!source.session->closed) {
+				// Close only the session whose console fails.
+				try {
+					source.session->console->flushMessages();
+				} catch(std::exception const &) {
+					close(*source.session);
+					break;
+				}
+				send(*source.session);
+			}
+			break;
+		}
+	}
+	
+	// Destroy sessions closed while processing events, freeing descriptors
+	// for pending connections.
+	for(int fd : _closed) {
+		_sessions.erase(fd);
+	}
+	if(!_closed.empty() || (!_accepting &&
+	   std::chrono::steady_clock::now() >= _pausedAt + acceptRetry)) {
+		resumeAccepting();
+	}
+	_closed.clear();
+	return !_stopped;
+}
+
+// Stop the server.
+void Server::stop() {
+	_stopped = true;
+	uint64_t one = 1;
+	ssize_t n = write(_wake.fd, &one, sizeof(one));
+	(void)n;
+}
+
+// Register the specified source for the specified events.
+void Server::watch(Source &source, uint32_t events) {
+	epoll_event event {};
+	event.events = events;
+	event.data.ptr = &source;
+	if(epoll_ctl(_epoll, EPOLL_CTL_ADD, source.fd, &event) == -1) {
+		throw std::runtime_error(
+			"Could not register file descriptor."
+		);
+	}
+}
+
+// Change the events of the specified registered source.
+void Server::rewatch(Source &source, uint32_t events) {
+	epoll_event event {};
+	event.events = events;
+	event.data.ptr = &source;
+	if(epoll_ctl(_epoll, EPOLL_CTL_MOD, source.fd, &event) == -1) {
+		throw std::runtime_error(
+			"Could not register file descriptor."
+		);
+	}
+}
+
+// Start listening on the specified bound socket.
+void Server::listen(int fd, bool telnet) {
+	_listeners.emplace_back(new Source { Source::LISTENER, fd, nullptr, telnet });
+	if(::listen(fd, SOMAXCONN) == -1) {
+		throw std::runtime_error(
+			"Could not listen on socket."
+		);
+	}
+	if(_accepting) {
+		watch(*_listeners.back(), EPOLLIN);
+	}
+}
+
+// Stop watching the listening sockets for connections.
+void Server::pauseAccepting() {
+	if(!_accepting) {
+		return;
+	}
+	_accepting = false;
+	_pausedAt = std::chrono::steady_clock::now();
+	for(auto const &listener : _listeners) {
+		epoll_ctl(_epoll, EPOLL_CTL_DEL, listener->fd, nullptr);
+	}
+}
+
+// Resume watching the listening sockets for connections.
+void Server::resumeAccepting() {
+	if(_accepting) {
+		return;
+	}
+	_accepting = true;
+	for(auto const &listener : _listeners) {
+		watch(*listener, EPOLLIN);
+	}
+}
+
+// Accept all pending connections of the specified listener.
+void Server::accept(Source &listener) {
+	while(true) {
+		int fd = accept4(listener.fd, nullptr, nullptr,
+		                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if(fd == -1) {
+			if(errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			// Leave connections exceeding the descriptor limit pending until a
+			// session closes, as the level-triggered listener would otherwise
+			// report them again right away.
+			if(errno == EMFILE || errno == ENFILE || errno == ENOBUFS ||
+			   errno == ENOMEM) {
+				pauseAccepting();
+			}
+			return;
+		}
+		
+		std::unique_ptr<Session> session(new Session(fd, listener.telnet));
+		if(listener.telnet) {
+			// Echo and edit on the server, one character at a time.
+			int on = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+			unsigned char const negotiation[] {
+				Telnet::IAC, Telnet::WILL, Telnet::ECHO,
+				Telnet::IAC, Telnet::WILL, Telnet::SUPPRESS_GO_AHEAD
+			};
+			session->output.writeRaw((char const *)negotiation,
+			                         sizeof(negotiation));
+		}
+		try {
+			session->console = _factory(session->output);
+		} catch(std::system_error const &error) {
+			// Drop the connection if its console cannot be created, waiting
+			// for a session to close if out of descriptors.
+			if(error.code() == std::errc::too_many_files_open ||
+			   error.code() == std::errc::too_many_files_open_in_system) {
+				pauseAccepting();
+				return;
+			}
+			continue;
+		} catch(std::exception const &) {
+			continue;
+		}
+		session->messages.fd = session->console->messageFd();
+		
+		Session &s = *session;
+		_sessions.emplace(fd, std::move(session));
+		watch(s.input, EPOLLIN);
+		if(s.messages.fd != -1) {
+			watch(s.messages, EPOLLIN);
+		}
+		send(s);
+	}
+}
+
+// Read and process input of the specified session.
+void Server::receive(Session &session) {
+	// Process a single chunk per event, so no session starves the others.
+	char buffer[4096];
+	ssize_t n = read(session.input.fd, buffer, sizeof(buffer));
+	if(n < 0) {
+		if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			close(session);
+		}
+		return;
+	}
+	if(n == 0) {
+		close(session);
+		return;
+	}
+	
+	size_t size = n;
+	if(session.input.telnet) {
+		size = Telnet::filter(session.state, buffer, size);
+	}
+	// Close only the session whose console fails, e.g. on a history file
+	// that cannot be written or a throwing command handler.
+	bool running;
+	try {
+		running = session.console->feed(buffer, size);
+	} catch(std::exception const &) {
+		close(session);
+		return;
+	}
+	send(session);
+	if(!running) {
+		close(session);
+	}
+}
+
+// Write pending output of the specified session.
+void Server::send(Session &session) {
+	if(!session.output.send(session.input.fd) ||
+	   session.output.pending() > maxPending) {
+		close(session);
+		return;
+	}
+	
+	// Wait for the client to accept the remaining output.
+	bool blocked = session.output.pending() > 0;
+	if(blocked != session.blocked) {
+		session.blocked = blocked;
+		rewatch(session.input, blocked ? EPOLLIN | EPOLLOUT : EPOLLIN);
+	}
+}
+
+// Close the specified session once the current events are processed.
+void Server::close(Session &session) {
+	if(session.closed) {
+		return;
+	}
+	session.closed = true;
+	
+	// Stop watching, as descriptors are only closed once the session is
+	// destroyed.
+	epoll_ctl(_epoll, EPOLL_CTL_DEL, session.input.fd, nullptr);
+	if(session.messages.fd != -1) {
+		epoll_ctl(_epoll, EPOLL_CTL_DEL, session.messages.fd, nullptr);
+	}
+	_closed.push_back(session.input.fd);
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
@@ -0,0 +1,144 @@
+#ifndef CONSOLE_SERVER_H
+#define CONSOLE_SERVER_H
+
+#include "console.h"
+#include "output.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                              Class Server                                --
+//------------------------------------------------------------------------------
+// Serves a console session to every client connecting to a Unix domain socket
+// or, telnet-style, to a TCP port. All sessions are multiplexed on a single
+// epoll loop run by the calling thread, so their consoles may share a History.
+// Output is buffered per session and written as the client accepts it; clients
+// falling too far behind are disconnected. Only available on Linux.
+class Server {
+	// Not copyable nor assignable.
+	Server(Server const &) = delete;
+	Server &operator=(Server const &) = delete;
+	
+public:
+	// Creates the console of a new session, writing to the specified output.
+	// The console must not put the terminal into raw mode. Running out of
+	// descriptors is reported by throwing std::system_error with the errno
+	// code, which pauses accepting until a session closes.
+	using Factory = std::function<std::unique_ptr<Console>(Output &output)>;
+	
+	// Construct a server creating consoles with the specified factory.
+	explicit Server(Factory factory);
+	// Disconnect all sessions and stop listening.
+	~Server();
+	
+	// Accept sessions on the Unix domain socket at the specified path,
+	// replacing any existing socket file.
+	void listenUnix(std::string const &path);
+	// Accept telnet sessions on the specified TCP port and IPv4 address.
+	void listenTcp(uint16_t port, std::string const &address = "127.0.0.1");
+	
+	// Retrieve the number of connected sessions.
+	size_t sessions() const { return _sessions.size(); }
+	
+	// Wait up to timeout milliseconds (indefinitely if negative) for events and
+	// process them. Returns false once the server has been stopped.
+	bool poll(int timeout = -1);
+	// Process events until the server is stopped.
+	void run() { while(poll()); }
+	// Stop the server. May be called from any thread.
+	void stop();
+	
+private:
+	struct Session;
+	
+	// Registered file descriptor and what it belongs to.
+	struct Source {
+		enum Kind { WAKE, LISTENER, INPUT, MESSAGES } kind;
+		int fd;
+		// Session of INPUT and MESSAGES sources.
+		Session *session;
+		// Indicator of telnet sessions accepted by a LISTENER.
+		bool telnet;
+	};
+	
+	// Output buffering the bytes of a session until its client accepts them.
+	class SessionOutput : public Output {
+	public:
+		SessionOutput(bool telnet) : _telnet(telnet), _offset(0) { }
+		
+		// Append the specified bytes, translating new-lines to CR LF.
+		virtual void write(char const *data, size_t size) override;
+		// Append the specified bytes unmodified.
+		void writeRaw(char const *data, size_t size) {
+			_buffer.append(data, size);
+		}
+		
+		// Retrieve the number of bytes not written to the client yet.
+		size_t pending() const { return _buffer.size() - _offset; }
+		// Write as many pending bytes as possible to the specified non-blocking
+		// file descriptor. Returns false if the client has disconnected.
+		bool send(int fd);
+	
+	private:
+		bool _telnet;
+		std::string _buffer;
+		size_t _offset;
+	};
+	
+private:
+	// Register the specified source for the specified events.
+	void watch(Source &source, uint32_t events);
+	// Change the events of the specified registered source.
+	void rewatch(Source &source, uint32_t events);
+	// Start listening on the specified bound socket.
+	void listen(int fd, bool telnet);
+	// Stop or resume watching the listening sockets for connections.
+	void pauseAccepting();
+	void resumeAccepting();
+	
+	// Accept all pending connections of the specified listener.
+	void accept(Source &listener);
+	// Read and process input of the specified session.
+	void receive(Session &session);
+	// Write pending output of the specified session, closing it if the
+	// client has disconnected or fallen too far behind.
+	void send(Session &session);
+	// Close the specified session once the current events are processed.
+	void close(Session &session);
+	
+private:
+	Factory _factory;
+	// Epoll instance and eventfd waking it up on stop.
+	int _epoll;
+	Source _wake;
+	std::atomic<bool> _stopped;
+	
+	// Listening sockets, and the path of the Unix domain socket if any.
+	std::vector<std::unique_ptr<Source>> _listeners;
+	std::string _unixPath;
+	// Indicator of watching the listening sockets, paused while out of file
+	// descriptors, and the time accepting has been paused.
+	bool _accepting;
+	std::chrono::steady_clock::time_point _pausedAt;
+	
+	// Sessions by socket, and those closed while processing events.
+	std::unordered_map<int, std::unique_ptr<Session>> _sessions;
+	std::vector<int> _closed;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
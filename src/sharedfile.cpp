@@ -0,0 +1,284 @@
+#include "sharedfile.h"
+#include "historyfile.h"
+
+#if !(defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64))
+#	include <fcntl.h>
+#	include <sys/file.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                             Class SharedFile                             --
+//------------------------------------------------------------------------------
+#if defined(_WIN32) || defined(_WIN64) || defined(WIN32) || defined(WIN64)
+
+SharedFile::SharedFile(std::string path, size_t maxEntries)
+: _path(std::move(path))
+, _maxEntries(maxEntries)
+, _fd(-1) {
+	throw std::runtime_error(
+		"Shared history is not supported on this platform."
+	);
+}
+
+SharedFile::~SharedFile() { }
+
+bool SharedFile::update(std::vector<std::string> &) { return false; }
+
+bool SharedFile::append(std::string_view, std::vector<std::string> &) {
+	return false;
+}
+
+#else
+
+// Open the shared file at the specified path.
+SharedFile::SharedFile(std::string path, size_t maxEntries)
+: _path(std::move(path))
+, _maxEntries(maxEntries)
+, _fd(-1)
+, _device(0)
+, _inode(0)
+, _offset(0)
+, _entries(0)
+, _initial(true) {
+	_fd = open(_path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+	struct stat st;
+	if(_fd == -1 || fstat(_fd, &st) == -1) {
+		throw std::runtime_error(
+			"Could not open shared history."
+		);
+	}
+	_device = st.st_dev;
+	_inode = st.st_ino;
+}
+
+SharedFile::~SharedFile() {
+	close(_fd);
+}
+
+// Collect the entries appended since the last update into entries.
+bool SharedFile::update(std::vector<std::string> &entries) {
+	entries.clear();
+	
+	// Skip locking if the file has neither been replaced nor grown.
+	struct stat st;
+	if(!_initial && stat(_path.c_str(), &st) == 0 &&
+	   uint64_t(st.st_dev) == _device && uint64_t(st.st_ino) == _inode &&
+	   uint64_t(st.st_size) == _offset) {
+		return false;
+	}
+	
+	bool reload = lock(LOCK_SH) || _initial;
+	read(reload, entries);
+	unlock();
+	return reload;
+}
+
+// Append the specified entry.
+bool SharedFile::append(std::string_view entry,
+                        std::vector<std::string> &entries) {
+	entries.clear();
+	
+	bool reload = lock(LOCK_EX) || _initial;
+	uint64_t offset = _offset;
+	size_t count = _entries;
+	read(reload, entries);
+	
+	// The end of the file is stable under the lock, so a failed write can be
+	// truncated back to it.
+	struct stat st;
+	bool failed = fstat(_fd, &st) == -1;
+	uint64_t end = failed ? 0 : uint64_t(st.st_size);
+	_buffer.assign(entry.data(), entry.size());
+	_buffer += '\n';
+	for(size_t done = 0; !failed && done < _buffer.size();) {
+		ssize_t n = write(_fd, _buffer.data() + done, _buffer.size() - done);
+		if(n < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			while(ftruncate(_fd, off_t(end)) == -1 && errno == EINTR);
+			failed = true;
+			break;
+		}
+		done += size_t(n);
+	}
+	if(failed) {
+		// Neither count the entry nor lose those collected, which are read
+		// again on the next update.
+		unlock();
+		entries.clear();
+		_initial = reload;
+		_offset = offset;
+		_entries = count;
+		throw std::runtime_error(
+			"Could not write shared history."
+		);
+	}
+	// Skip the entry unless it follows an incomplete line, which is then read
+	// together with it.
+	if(end == _offset) {
+		_offset += _buffer.size();
+	}
+	++_entries;
+	
+	if(_entries > 2 * _maxEntries) {
+		compact();
+	}
+	unlock();
+	return reload;
+}
+
+// Lock the file, reopening it if it has been replaced.
+bool SharedFile::lock(int operation) {
+	bool reopened = false;
+	while(true) {
+		while(flock(_fd, operation) == -1 && errno == EINTR);
+		
+		// A replaced file is still locked, so check the identity afterwards.
+		struct stat st;
+		if(stat(_path.c_str(), &st) == -1 ||
+		   (uint64_t(st.st_dev) == _device && uint64_t(st.st_ino) == _inode)) {
+			return reopened;
+		}
+		
+		int fd = open(_path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC,
+		              0600);
+		if(fd == -1 || fstat(fd, &st) == -1) {
+			if(fd != -1) {
+				close(fd);
+			}
+			return reopened;
+		}
+		close(_fd);
+		_fd = fd;
+		_device = st.st_dev;
+		_inode = st.st_ino;
+		reopened = true;
+	}
+}
+
+// Unlock the file.
+void SharedFile::unlock() {
+	flock(_fd, LOCK_UN);
+}
+
+// Read the entries appended since the last read, or the complete tail.
+void SharedFile::read(bool reload, std::vector<std::string> &entries) {
+	_initial = false;
+	
+	struct stat st;
+	if(fstat(_fd, &st) == -1) {
+		return;
+	}
+	uint64_t size = uint64_t(st.st_size);
+	
+	// Reload the tail of a replaced or truncated file.
+	if(reload || size < _offset) {
+		MappedFile file(_path);
+		std::vector<std::string_view> lines = tailLines(file, _maxEntries);
+		entries.assign(lines.begin(), lines.end());
+		_entries = lines.size();
+		_offset = file.size();
+		return;
+	}
+	
+	// Read only the appended tail, consuming complete lines.
+	_buffer.resize(size_t(size - _offset));
+	size_t length = 0;
+	while(length < _buffer.size()) {
+		ssize_t n = pread(_fd, &_buffer[length], _buffer.size() - length,
+		                  off_t(_offset + length));
+		if(n <= 0) {
+			if(n < 0 && errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		length += size_t(n);
+	}
+	size_t begin = 0;
+	for(size_t i = 0; i < length; ++i) {
+		if(_buffer[i] == '\n' || _buffer[i] == '\r') {
+			if(i > begin) {
+				entries.emplace_back(_buffer, begin, i - begin);
+				++_entries;
+			}
+			begin = i + 1;
+		}
+	}
+	_offset += begin;
+}
+
+// Rewrite the file to contain only the most recent entries.
+void SharedFile::compact() {
+	std::string temp = _path + ".tmp";
+	size_t entries = 0;
+	uint64_t size = 0;
+	{
+		MappedFile file(_path);
+		std::vector<std::string_view> lines = tailLines(file, _maxEntries);
+		
+		std::FILE *out = std::fopen(temp.c_str(), "wb");
+		if(!out) {
+			return;
+		}
+		bool failed = false;
+		for(std::string_view line : lines) {
+			if(std::fwrite(line.data(), 1, line.size(), out) != line.size() ||
+			   std::fputc('\n', out) == EOF) {
+				failed = true;
+				break;
+			}
+			size += line.size() + 1;
+		}
+		// Never replace the file with an incompletely written one.
+		failed = failed || std::fflush(out) != 0 || fsync(fileno(out)) != 0 ||
+		         std::ferror(out);
+		failed = std::fclose(out) != 0 || failed;
+		if(failed) {
+			std::remove(temp.c_str());
+			return;
+		}
+		entries = lines.size();
+	}
+	if(std::rename(temp.c_str(), _path.c_str()) != 0) {
+		std::remove(temp.c_str());
+		return;
+	}
+	
+	// Other processes may append to the replacement file before it is locked,
+	// so continue reading after the compacted entries rather than at its end.
+	int fd = open(_path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+	if(fd == -1) {
+		return;
+	}
+	while(flock(fd, LOCK_EX) == -1 && errno == EINTR);
+	struct stat st;
+	if(fstat(fd, &st) == -1) {
+		close(fd);
+		return;
+	}
+	unlock();
+	close(_fd);
+	_fd = fd;
+	_device = st.st_dev;
+	_inode = st.st_ino;
+	_offset = size;
+	_entries = entries;
+}
+
+#endif
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
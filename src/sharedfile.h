@@ -0,0 +1,74 @@
+#ifndef CONSOLE_SHAREDFILE_H
+#define CONSOLE_SHAREDFILE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                             Class SharedFile                             --
+//------------------------------------------------------------------------------
+// History file shared between concurrent processes. Entries are appended with
+// O_APPEND under an advisory lock, and entries appended by other processes are
+// pulled in incrementally by reading only the new tail of the file.
+class SharedFile {
+	// Not copyable nor assignable.
+	SharedFile(SharedFile const &) = delete;
+	SharedFile &operator=(SharedFile const &) = delete;
+	
+public:
+	// Open the shared file at the specified path, retaining at least
+	// maxEntries entries when compacting it.
+	SharedFile(std::string path, size_t maxEntries);
+	~SharedFile();
+	
+	// Collect the entries appended since the last update into entries.
+	// Returns true if the file has been replaced or is read for the first
+	// time, in which case entries holds its complete retained tail instead.
+	bool update(std::vector<std::string> &entries);
+	// Append the specified entry, after collecting the entries appended by
+	// other processes as by update.
+	// Throws if the entry could not be written, in which case neither the
+	// file nor the entries read so far are affected.
+	bool append(std::string_view entry, std::vector<std::string> &entries);
+	
+private:
+	// Lock the file, reopening it if it has been replaced.
+	// Returns true if the file has been reopened.
+	bool lock(int operation);
+	// Unlock the file.
+	void unlock();
+	// Read the entries appended since the last read, or the complete tail if
+	// reload is set, into entries.
+	void read(bool reload, std::vector<std::string> &entries);
+	// Rewrite the file to contain only the most recent entries.
+	void compact();
+	
+private:
+	std::string const _path;
+	size_t const _maxEntries;
+	
+	int _fd;
+	// Identity of the open file.
+	uint64_t _device;
+	uint64_t _inode;
+	// Number of bytes of the file read so far.
+	uint64_t _offset;
+	// Approximate number of entries in the file.
+	size_t _entries;
+	// Indicator that the file has not been read yet.
+	bool _initial;
+	// Buffer for reading appended entries.
+	std::string _buffer;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,85 @@
+#include "threadpool.h"
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                            Class ThreadPool                              --
+//------------------------------------------------------------------------------
+
+// Start a pool running batches on the specified number of threads.
+ThreadPool::ThreadPool(size_t threads)
+: _task(nullptr)
+, _count(0)
+, _next(0)
+, _batches(0)
+, _active(0)
+, _stop(false) {
+	for(size_t i = 1; i < threads; ++i) {
+		_threads.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+// Stop and join the worker threads.
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for(std::thread &thread : _threads) {
+		thread.join();
+	}
+}
+
+// Run task(i) for every i in [0, count), returning once all have finished.
+void ThreadPool::run(size_t count, std::function<void(size_t)> const &task) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_task = &task;
+		_count = count;
+		_next = 0;
+		_active = _threads.size();
+		++_batches;
+	}
+	_wake.notify_all();
+	
+	runTasks();
+	
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done.wait(lock, [this] { return !_active; });
+	_task = nullptr;
+}
+
+// Worker thread taking part in every batch.
+void ThreadPool::work() {
+	uint64_t batches = 0;
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(true) {
+		_wake.wait(lock, [&] { return _stop || _batches != batches; });
+		if(_stop) {
+			return;
+		}
+		batches = _batches;
+		
+		lock.unlock();
+		runTasks();
+		lock.lock();
+		
+		if(!--_active) {
+			_done.notify_one();
+		}
+	}
+}
+
+// Run the tasks of the current batch until none are left.
+void ThreadPool::runTasks() {
+	for(size_t i; (i = _next.fetch_add(1)) < _count;) {
+		(*_task)(i);
+	}
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
@@ -0,0 +1,65 @@
+#ifndef CONSOLE_THREADPOOL_H
+#define CONSOLE_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                            Class ThreadPool                              --
+//------------------------------------------------------------------------------
+// Fixed set of worker threads running batches of independent tasks. The thread
+// submitting a batch takes part in it and waits for its completion.
+class ThreadPool {
+	// Not copyable nor assignable.
+	ThreadPool(ThreadPool const &) = delete;
+	ThreadPool &operator=(ThreadPool const &) = delete;
+	
+public:
+	// Start a pool running batches on the specified number of threads,
+	// including the submitting thread.
+	explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+	// Stop and join the worker threads.
+	~ThreadPool();
+	
+	// Retrieve the number of threads running a batch.
+	size_t size() const { return _threads.size() + 1; }
+	
+	// Run task(i) for every i in [0, count), returning once all have finished.
+	void run(size_t count, std::function<void(size_t)> const &task);
+	
+private:
+	// Worker thread taking part in every batch.
+	void work();
+	// Run the tasks of the current batch until none are left.
+	void runTasks();
+	
+private:
+	std::vector<std::thread> _threads;
+	
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	// Current batch, its size and the next unclaimed task.
+	std::function<void(size_t)> const *_task;
+	size_t _count;
+	std::atomic<size_t> _next;
+	// Number of batches started and of workers still running the current one.
+	uint64_t _batches;
+	size_t _active;
+	bool _stop;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,177 @@
+#include "trie.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                               Class Trie                                 --
+//------------------------------------------------------------------------------
+
+Trie::Trie()
+: _nodes(1) { }
+
+// Add the specified word.
+void Trie::insert(std::string_view word) {
+	if(contains(word)) {
+		return;
+	}
+	if(_labels.size() + word.size() > UINT32_MAX) {
+		throw std::runtime_error(
+			"Completion vocabulary is too large."
+		);
+	}
+	
+	uint32_t node = 0;
+	size_t pos = 0;
+	++_nodes[node].count;
+	while(pos < word.size()) {
+		auto it = findChild(node, word[pos]);
+		if(it == _nodes[node].children.end() || !startsWith(*it, word[pos])) {
+			// Add a leaf holding the remainder of the word.
+			Node leaf { uint32_t(_labels.size()), uint32_t(word.size() - pos), 1,
+			            true, {} };
+			_labels.append(word.substr(pos));
+			size_t index = it - _nodes[node].children.begin();
+			_nodes.push_back(std::move(leaf));
+			_nodes[node].children.insert(_nodes[node].children.begin() + index,
+			                             uint32_t(_nodes.size() - 1));
+			return;
+		}
+		
+		uint32_t child = *it;
+		std::string_view edge = label(child);
+		size_t common = 0;
+		size_t size = std::min(edge.size(), word.size() - pos);
+		while(common < size && edge[common] == word[pos + common]) {
+			++common;
+		}
+		if(common < edge.size()) {
+			// Split the edge, sharing the label of the child.
+			size_t index = it - _nodes[node].children.begin();
+			Node middle { _nodes[child].offset, uint32_t(common),
+			              _nodes[child].count, false, { child } };
+			_nodes[child].offset += uint32_t(common);
+			_nodes[child].length -= uint32_t(common);
+			_nodes.push_back(std::move(middle));
+			_nodes[node].children[index] = uint32_t(_nodes.size() - 1);
+			child = uint32_t(_nodes.size() - 1);
+		}
+		node = child;
+		pos += common;
+		++_nodes[node].count;
+	}
+	_nodes[node].terminal = true;
+}
+
+// Remove all words.
+void Trie::clear() {
+	_nodes.assign(1, Node());
+	_labels.clear();
+}
+
+// Check if the trie contains the specified word.
+bool Trie::contains(std::string_view word) const {
+	Match match;
+	return find(word, match) && match.length == _nodes[match.node].length &&
+	       _nodes[match.node].terminal;
+}
+
+// Retrieve the number of words starting with prefix.
+size_t Trie::count(std::string_view prefix) const {
+	Match match;
+	return find(prefix, match) ? _nodes[match.node].count : 0;
+}
+
+// Retrieve the longest common prefix of the words starting with prefix.
+std::string Trie::commonPrefix(std::string_view prefix) const {
+	Match match;
+	if(!find(prefix, match) || !_nodes[match.node].count) {
+		return std::string();
+	}
+	std::string result(prefix);
+	result += label(match.node).substr(match.length);
+	for(uint32_t node = match.node;
+	    !_nodes[node].terminal && _nodes[node].children.size() == 1;) {
+		node = _nodes[node].children.front();
+		result += label(node);
+	}
+	return result;
+}
+
+// Append up to limit words starting with prefix to words.
+void Trie::list(std::string_view prefix, size_t offset, size_t limit,
+                std::vector<std::string> &words) const {
+	Match match;
+	if(!find(prefix, match) || !limit) {
+		return;
+	}
+	std::string path(prefix);
+	path += label(match.node).substr(match.length);
+	collect(match.node, path, offset, limit, words);
+}
+
+// Find the first child of node whose label does not start before c.
+std::vector<uint32_t>::const_iterator Trie::findChild(uint32_t node,
+                                                      char c) const {
+	std::vector<uint32_t> const &children = _nodes[node].children;
+	return std::lower_bound(children.begin(), children.end(), c,
+		[this](uint32_t child, char c) {
+			return uint8_t(_labels[_nodes[child].offset]) < uint8_t(c);
+		});
+}
+
+// Find the position of prefix, returning false if no word starts with it.
+bool Trie::find(std::string_view prefix, Match &match) const {
+	match = { 0, 0 };
+	size_t pos = 0;
+	while(pos < prefix.size()) {
+		auto it = findChild(match.node, prefix[pos]);
+		if(it == _nodes[match.node].children.end() ||
+		   !startsWith(*it, prefix[pos])) {
+			return false;
+		}
+		std::string_view edge = label(*it);
+		size_t size = std::min(edge.size(), prefix.size() - pos);
+		if(edge.substr(0, size) != prefix.substr(pos, size)) {
+			return false;
+		}
+		match = { *it, uint32_t(size) };
+		pos += size;
+	}
+	return true;
+}
+
+// Append the words below node to words, extending path.
+void Trie::collect(uint32_t node, std::string &path, size_t &offset,
+                   size_t &limit, std::vector<std::string> &words) const {
+	if(_nodes[node].terminal) {
+		if(offset) {
+			--offset;
+		} else {
+			words.push_back(path);
+			--limit;
+		}
+	}
+	for(uint32_t child : _nodes[node].children) {
+		if(!limit) {
+			return;
+		}
+		// Skip complete subtrees before the requested page.
+		if(offset >= _nodes[child].count) {
+			offset -= _nodes[child].count;
+			continue;
+		}
+		size_t size = path.size();
+		path += label(child);
+		collect(child, path, offset, limit, words);
+		path.resize(size);
+	}
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
@@ -0,0 +1,91 @@
+#ifndef CONSOLE_TRIE_H
+#define CONSOLE_TRIE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                               Class Trie                                 --
+//------------------------------------------------------------------------------
+// Compressed prefix trie of words. Edges are labelled with byte strings stored
+// in a shared pool, and every node counts the words below it, so finding the
+// words starting with a prefix takes time proportional to the prefix length,
+// and listing a page of them skips complete subtrees.
+class Trie {
+public:
+	Trie();
+	
+	// Add the specified word.
+	void insert(std::string_view word);
+	// Remove all words.
+	void clear();
+	
+	// Check if the trie contains the specified word.
+	bool contains(std::string_view word) const;
+	// Retrieve the number of words.
+	size_t size() const { return _nodes[0].count; }
+	// Check if the trie holds no words.
+	bool empty() const { return !size(); }
+	
+	// Retrieve the number of words starting with prefix.
+	size_t count(std::string_view prefix) const;
+	// Retrieve the longest common prefix of the words starting with prefix, or
+	// an empty string if there are none.
+	std::string commonPrefix(std::string_view prefix) const;
+	// Append up to limit words starting with prefix to words, in byte order,
+	// skipping the first offset of them.
+	void list(std::string_view prefix, size_t offset, size_t limit,
+	          std::vector<std::string> &words) const;
+	
+private:
+	struct Node {
+		// Edge label leading to this node, within _labels.
+		uint32_t offset;
+		uint32_t length;
+		// Number of words ending at or below this node.
+		uint32_t count;
+		// Indicator of a word ending at this node.
+		bool terminal;
+		// Child nodes ordered by the first octet of their labels.
+		std::vector<uint32_t> children;
+	};
+	
+	// Position of a prefix, ending length octets into the label of node.
+	struct Match {
+		uint32_t node;
+		uint32_t length;
+	};
+	
+private:
+	// Retrieve the label of the specified node.
+	std::string_view label(uint32_t node) const {
+		return { _labels.data() + _nodes[node].offset, _nodes[node].length };
+	}
+	// Check if the label of node starts with c.
+	bool startsWith(uint32_t node, char c) const {
+		return _labels[_nodes[node].offset] == c;
+	}
+	// Find the first child of node whose label does not start before c.
+	std::vector<uint32_t>::const_iterator findChild(uint32_t node, char c) const;
+	// Find the position of prefix, returning false if no word starts with it.
+	bool find(std::string_view prefix, Match &match) const;
+	// Append the words below node to words, extending path.
+	void collect(uint32_t node, std::string &path, size_t &offset, size_t &limit,
+	             std::vector<std::string> &words) const;
+	
+private:
+	std::vector<Node> _nodes;
+	std::string _labels;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
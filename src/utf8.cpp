@@ -0,0 +1,271 @@
+#include "utf8.h"
+
+#if defined(__AVX2__)
+#	include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#	include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//                     Begin namespace <helper functions>                     //
+namespace {
+
+//------------------------------------------------------------------------------
+//--                          Bit Helper Functions                            --
+//------------------------------------------------------------------------------
+// Count the set bits of mask.
+inline unsigned popcount(uint32_t mask) {
+#if defined(_MSC_VER)
+	return __popcnt(mask);
+#else
+	return __builtin_popcount(mask);
+#endif
+}
+
+// Index of the lowest set bit of a non-zero mask.
+inline unsigned lowestBit(uint32_t mask) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+//------------------------------------------------------------------------------
+//--                         Chunk Helper Functions                           --
+//------------------------------------------------------------------------------
+// Mask the octets of a 16 byte chunk that start a codepoint.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+inline uint32_t leadMask16(char const *data) {
+	__m128i chunk = _mm_loadu_si128((__m128i const *)data);
+	// Continuation octets 0x80-0xbf are the signed values below -64.
+	__m128i cont = _mm_cmplt_epi8(chunk, _mm_set1_epi8(-64));
+	return ~uint32_t(_mm_movemask_epi8(cont)) & 0xffff;
+}
+#endif
+
+// Mask the octets of a 32 byte chunk that start a codepoint.
+#if defined(__AVX2__)
+inline uint32_t leadMask32(char const *data) {
+	__m256i chunk = _mm256_loadu_si256((__m256i const *)data);
+	__m256i cont = _mm256_cmpgt_epi8(_mm256_set1_epi8(-64), chunk);
+	return ~uint32_t(_mm256_movemask_epi8(cont));
+}
+#endif
+
+// Mask the non-ascii octets of a 16 byte chunk.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+inline uint32_t highMask16(char const *data) {
+	__m128i chunk = _mm_loadu_si128((__m128i const *)data);
+	return uint32_t(_mm_movemask_epi8(chunk));
+}
+#endif
+
+// Mask the non-ascii octets of a 32 byte chunk.
+#if defined(__AVX2__)
+inline uint32_t highMask32(char const *data) {
+	__m256i chunk = _mm256_loadu_si256((__m256i const *)data);
+	return uint32_t(_mm256_movemask_epi8(chunk));
+}
+#endif
+
+// Mask the octets of a 16 byte chunk that are not printable ascii.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+inline uint32_t unprintableMask16(char const *data) {
+	__m128i chunk = _mm_loadu_si128((__m128i const *)data);
+	// Printable octets 0x20-0x7e are the signed values above 31 and below 127.
+	__m128i printable = _mm_and_si128(
+		_mm_cmpgt_epi8(chunk, _mm_set1_epi8(0x1f)),
+		_mm_cmplt_epi8(chunk, _mm_set1_epi8(0x7f))
+	);
+	return ~uint32_t(_mm_movemask_epi8(printable)) & 0xffff;
+}
+#endif
+
+// Mask the octets of a 32 byte chunk that are not printable ascii.
+#if defined(__AVX2__)
+inline uint32_t unprintableMask32(char const *data) {
+	__m256i chunk = _mm256_loadu_si256((__m256i const *)data);
+	__m256i printable = _mm256_and_si256(
+		_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(0x1f)),
+		_mm256_cmpgt_epi8(_mm256_set1_epi8(0x7f), chunk)
+	);
+	return ~uint32_t(_mm256_movemask_epi8(printable));
+}
+#endif
+
+//------------------------------------------------------------------------------
+//--                      Validation Helper Functions                         --
+//------------------------------------------------------------------------------
+// Length of the sequence at the start of data if well-formed, 0 otherwise.
+size_t validSequence(unsigned char const *data, size_t size) {
+	unsigned char c = data[0];
+	size_t length;
+	unsigned char low = 0x80, high = 0xbf;
+	if(c < 0x80) {
+		return 1;
+	} else if(c < 0xc2) {
+		return 0;
+	} else if(c < 0xe0) {
+		length = 2;
+	} else if(c < 0xf0) {
+		length = 3;
+		// Reject overlong forms and surrogates.
+		if(c == 0xe0) {
+			low = 0xa0;
+		} else if(c == 0xed) {
+			high = 0x9f;
+		}
+	} else if(c < 0xf5) {
+		length = 4;
+		// Reject overlong forms and codepoints above U+10FFFF.
+		if(c == 0xf0) {
+			low = 0x90;
+		} else if(c == 0xf4) {
+			high = 0x8f;
+		}
+	} else {
+		return 0;
+	}
+	if(size < length || data[1] < low || data[1] > high) {
+		return 0;
+	}
+	for(size_t i = 2; i < length; ++i) {
+		if((data[i] & 0xc0) != 0x80) {
+			return 0;
+		}
+	}
+	return length;
+}
+
+}
+//                      End namespace <helper functions>                      //
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//--                          UTF-8 Bulk Functions                            --
+//------------------------------------------------------------------------------
+namespace Utf8 {
+	// Count number of utf8 codepoints in the buffer.
+	size_t count(char const *data, size_t size) {
+		size_t n = 0;
+		size_t i = 0;
+#if defined(__AVX2__)
+		for(; size - i >= 32; i += 32) {
+			n += popcount(leadMask32(data + i));
+		}
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+		for(; size - i >= 16; i += 16) {
+			n += popcount(leadMask16(data + i));
+		}
+#endif
+		for(; i < size; ++i) {
+			n += (data[i] & 0xc0) != 0x80;
+		}
+		return n;
+	}
+	
+	// Retrieve the offset after skipping n codepoints, at most size.
+	size_t advance(char const *data, size_t size, size_t n) {
+		size_t i = 0;
+		// Skip complete chunks that do not hold the target codepoint.
+#if defined(__AVX2__)
+		for(; size - i >= 32; i += 32) {
+			size_t leads = popcount(leadMask32(data + i));
+			if(leads > n) {
+				break;
+			}
+			n -= leads;
+		}
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+		for(; size - i >= 16; i += 16) {
+			size_t leads = popcount(leadMask16(data + i));
+			if(leads > n) {
+				break;
+			}
+			n -= leads;
+		}
+#endif
+		for(; i < size; ++i) {
+			if((data[i] & 0xc0) != 0x80) {
+				if(!n) {
+					break;
+				}
+				--n;
+			}
+		}
+		return i;
+	}
+	
+	// Check if the buffer holds well-formed utf8.
+	bool valid(char const *data, size_t size) {
+		unsigned char const *bytes = (unsigned char const *)data;
+		size_t i = 0;
+		while(i < size) {
+			if(bytes[i] < 0x80) {
+				// Skip runs of ascii a chunk at a time.
+#if defined(__AVX2__)
+				if(size - i >= 32) {
+					uint32_t mask = highMask32(data + i);
+					i += mask ? lowestBit(mask) : 32;
+					continue;
+				}
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+				if(size - i >= 16) {
+					uint32_t mask = highMask16(data + i);
+					i += mask ? lowestBit(mask) : 16;
+					continue;
+				}
+#endif
+				++i;
+				continue;
+			}
+			size_t length = validSequence(bytes + i, size - i);
+			if(!length) {
+				return false;
+			}
+			i += length;
+		}
+		return true;
+	}
+	
+	// Retrieve the length of the leading run of printable ascii octets.
+	size_t printable(char const *data, size_t size) {
+		size_t i = 0;
+#if defined(__AVX2__)
+		for(; size - i >= 32; i += 32) {
+			if(uint32_t mask = unprintableMask32(data + i)) {
+				return i + lowestBit(mask);
+			}
+		}
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+		for(; size - i >= 16; i += 16) {
+			if(uint32_t mask = unprintableMask16(data + i)) {
+				return i + lowestBit(mask);
+			}
+		}
+#endif
+		while(i < size && data[i] >= 0x20 && data[i] < 0x7f) {
+			++i;
+		}
+		return i;
+	}
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
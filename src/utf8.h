@@ -0,0 +1,126 @@
+#ifndef CONSOLE_UTF8_H
+#define CONSOLE_UTF8_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                          UTF-8 Helper Functions                          --
+//------------------------------------------------------------------------------
+namespace Utf8 {
+	// The helpers accept any string type providing operator[] and size().
+	
+	// Count number of utf8 octets at position.
+	template<class String>
+	size_t countOctets(String const &str, size_t pos) {
+		uint8_t masked = uint8_t(str[pos]) & 0xff;
+		if(masked < 0x80) {
+			return 1;
+		} else if ((masked >> 5) == 0x6) {
+			return 2;
+		} else if ((masked >> 4) == 0xe) {
+			return 3;
+		} else if ((masked >> 3) == 0x1e) {
+			return 4;
+		} else {
+			return 0;
+		}
+	}
+	
+	// Previous utf8 starting position.
+	template<class String>
+	size_t posPrev(String const &str, size_t pos) {
+		if(pos) {
+			while((str[--pos] & 0xc0) == 0x80) {
+				if(pos == 0) {
+					break;
+				}
+			}
+		}
+		return pos;
+	}
+	
+	// Next utf8 starting position.
+	template<class String>
+	size_t posNext(String const &str, size_t pos) {
+		if(pos < str.size()) {
+			pos += countOctets(str, pos);
+			if(pos > str.size()) {
+				pos = str.size();
+			}
+		}
+		return pos;
+	}
+	
+	// Decode the utf8 codepoint at position, U+FFFD if it is malformed.
+	template<class String>
+	uint32_t decode(String const &str, size_t pos) {
+		size_t n = countOctets(str, pos);
+		if(!n || pos + n > str.size()) {
+			return 0xfffd;
+		}
+		uint32_t cp = uint8_t(str[pos]);
+		if(n > 1) {
+			cp &= 0xff >> (n + 1);
+			for(size_t i = 1; i < n; ++i) {
+				cp = (cp << 6) | (uint8_t(str[pos + i]) & 0x3f);
+			}
+		}
+		return cp;
+	}
+	
+	// Count number of utf8 codepoints in string, starting at pos.
+	template<class String>
+	size_t count(String const &str, size_t pos = 0) {
+		size_t n = 0;
+		for(; pos < str.size(); ++pos) {
+			n += (str[pos] & 0xc0) != 0x80;
+		}
+		return n;
+	}
+	
+	// Bulk primitives over contiguous buffers, vectorized where available.
+	// Every octet that is not a continuation octet starts a codepoint.
+	
+	// Count number of utf8 codepoints in the buffer.
+	size_t count(char const *data, size_t size);
+	// Retrieve the offset after skipping n codepoints, at most size.
+	size_t advance(char const *data, size_t size, size_t n);
+	// Check if the buffer holds well-formed utf8.
+	bool valid(char const *data, size_t size);
+	// Retrieve the length of the leading run of printable ascii octets.
+	size_t printable(char const *data, size_t size);
+	
+	// Count number of utf8 codepoints in string, starting at pos.
+	inline size_t count(std::string_view str, size_t pos = 0) {
+		return pos < str.size() ? count(str.data() + pos, str.size() - pos) : 0;
+	}
+	inline size_t count(std::string const &str, size_t pos = 0) {
+		return count(std::string_view(str), pos);
+	}
+	
+	// Position after skipping n codepoints, starting at pos.
+	inline size_t advance(std::string_view str, size_t pos, size_t n) {
+		if(pos >= str.size()) {
+			return str.size();
+		}
+		return pos + advance(str.data() + pos, str.size() - pos, n);
+	}
+	
+	// Check if the string holds well-formed utf8.
+	inline bool valid(std::string_view str) {
+		return valid(str.data(), str.size());
+	}
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
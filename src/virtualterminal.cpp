@@ -0,0 +1,311 @@
+#include "virtualterminal.h"
+#include "utf8.h"
+#include "width.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                          Class VirtualTerminal                           --
+//------------------------------------------------------------------------------
+
+// Construct a terminal with the specified screen size.
+VirtualTerminal::VirtualTerminal(size_t columns, size_t rows)
+: _columns(std::max<size_t>(columns, 1))
+, _rows(std::max<size_t>(rows, 1))
+, _cells(_rows, std::vector<std::string>(_columns))
+, _column(0)
+, _row(0)
+, _wrap(false)
+, _state(State::GROUND)
+, _bytes(0)
+, _sequences(0)
+, _bells(0)
+, _writes(0)
+, _writeBytes(0)
+, _writeSequences(0) { }
+
+// Interpret the specified bytes.
+void VirtualTerminal::write(char const *data, size_t size) {
+	size_t sequences = _sequences;
+	for(size_t i = 0; i < size; ++i) {
+		char c = data[i];
+		switch(_state) {
+		case State::GROUND:
+			ground(c);
+			break;
+		case State::ESCAPE:
+			if(c == '[') {
+				_params.clear();
+				_state = State::CSI;
+			} else {
+				// Other escape sequences have no effect on the screen.
+				++_sequences;
+				_state = State::GROUND;
+			}
+			break;
+		case State::CSI:
+			if(c >= 0x40 && c <= 0x7e) {
+				++_sequences;
+				execute(c);
+				_state = State::GROUND;
+			} else {
+				_params += c;
+			}
+			break;
+		}
+	}
+	_bytes += size;
+	++_writes;
+	_writeBytes = size;
+	_writeSequences = _sequences - sequences;
+}
+
+// Retrieve the text of the specified screen row, without trailing blanks.
+std::string VirtualTerminal::line(size_t row) const {
+	std::string text;
+	size_t blanks = 0;
+	for(size_t column = 0; column < _columns; ++column) {
+		std::string const &cell = _cells[row][column];
+		if(cell.empty()) {
+			// Skip the second cell of wide characters.
+			if(!column || Width::measure(_cells[row][column - 1]) < 2) {
+				++blanks;
+			}
+			continue;
+		}
+		text.append(blanks, ' ');
+		blanks = 0;
+		text += cell;
+	}
+	return text;
+}
+
+// Retrieve the text of the screen rows up to the last non-empty one.
+std::string VirtualTerminal::screen() const {
+	std::vector<std::string> lines;
+	for(size_t row = 0; row < _rows; ++row) {
+		lines.push_back(line(row));
+	}
+	while(!lines.empty() && lines.back().empty()) {
+		lines.pop_back();
+	}
+	std::string text;
+	for(size_t i = 0; i < lines.size(); ++i) {
+		if(i) {
+			text += '\n';
+		}
+		text += lines[i];
+	}
+	return text;
+}
+
+// Clear the screen and scrollback and home the cursor.
+void VirtualTerminal::clear() {
+	for(size_t row = 0; row < _rows; ++row) {
+		erase(row, 0, _columns);
+	}
+	_scrollback.clear();
+	_column = 0;
+	_row = 0;
+	_wrap = false;
+}
+
+// Reset all counters.
+void VirtualTerminal::resetCounters() {
+	_bytes = 0;
+	_sequences = 0;
+	_bells = 0;
+	_writes = 0;
+	_writeBytes = 0;
+	_writeSequences = 0;
+}
+
+// Interpret a byte outside of escape sequences.
+void VirtualTerminal::ground(char c) {
+	if(!_utf8.empty() || uint8_t(c) >= 0x80) {
+		_utf8 += c;
+		size_t octets = Utf8::countOctets(_utf8, 0);
+		if(!octets || octets == _utf8.size()) {
+			print();
+			_utf8.clear();
+		}
+		return;
+	}
+	switch(c) {
+	case '\033':
+		_state = State::ESCAPE;
+		break;
+	case '\a':
+		++_bells;
+		break;
+	case '\b':
+		_column -= _column > 0;
+		_wrap = false;
+		break;
+	case '\t':
+		_column = std::min(_columns - 1, (_column / 8 + 1) * 8);
+		break;
+	case '\n':
+		// Output post-processing returns the cursor on line feeds.
+		_column = 0;
+		lineFeed();
+		break;
+	case '\r':
+		_column = 0;
+		_wrap = false;
+		break;
+	default:
+		if(uint8_t(c) >= 0x20 && c != 0x7f) {
+			_utf8 = c;
+			print();
+			_utf8.clear();
+		}
+		break;
+	}
+}
+
+// Execute a complete CSI sequence.
+void VirtualTerminal::execute(char final) {
+	// Private modes such as bracketed paste have no effect on the screen.
+	if(!_params.empty() && (_params[0] == '?' || _params[0] == '>')) {
+		return;
+	}
+	_wrap = false;
+	switch(final) {
+	case 'A':
+		_row -= std::min(_row, parameter(0, 1));
+		break;
+	case 'B':
+		_row = std::min(_rows - 1, _row + parameter(0, 1));
+		break;
+	case 'C':
+		_column = std::min(_columns - 1, _column + parameter(0, 1));
+		break;
+	case 'D':
+		_column -= std::min(_column, parameter(0, 1));
+		break;
+	case 'G':
+		_column = std::min(_columns, std::max<size_t>(parameter(0, 1), 1)) - 1;
+		break;
+	case 'H':
+		_row = std::min(_rows, std::max<size_t>(parameter(0, 1), 1)) - 1;
+		_column = std::min(_columns, std::max<size_t>(parameter(1, 1), 1)) - 1;
+		break;
+	case 'J':
+		switch(parameter(0, 0)) {
+		case 0:
+			erase(_row, _column, _columns);
+			for(size_t row = _row + 1; row < _rows; ++row) {
+				erase(row, 0, _columns);
+			}
+			break;
+		case 1:
+			for(size_t row = 0; row < _row; ++row) {
+				erase(row, 0, _columns);
+			}
+			erase(_row, 0, _column + 1);
+			break;
+		default:
+			for(size_t row = 0; row < _rows; ++row) {
+				erase(row, 0, _columns);
+			}
+			break;
+		}
+		break;
+	case 'K':
+		switch(parameter(0, 0)) {
+		case 0:
+			erase(_row, _column, _columns);
+			break;
+		case 1:
+			erase(_row, 0, _column + 1);
+			break;
+		default:
+			erase(_row, 0, _columns);
+			break;
+		}
+		break;
+	default:
+		// Attributes and other sequences do not change the text on screen.
+		break;
+	}
+}
+
+// Place the complete codepoint in _utf8 at the cursor.
+void VirtualTerminal::print() {
+	uint32_t cp = Utf8::decode(_utf8, 0);
+	unsigned width = cp < 0x80 ? 1 : Width::columns(cp);
+	
+	// Attach zero width codepoints to the previous cell.
+	if(!width) {
+		size_t column = _wrap ? _column : _column - (_column > 0);
+		if(column && _cells[_row][column].empty()) {
+			--column;
+		}
+		_cells[_row][column] += _utf8;
+		return;
+	}
+	
+	if(_wrap || _column + width > _columns) {
+		_column = 0;
+		lineFeed();
+	}
+	erase(_row, _column, _column + width);
+	_cells[_row][_column] = _utf8;
+	_column += width;
+	if(_column >= _columns) {
+		_column = _columns - 1;
+		_wrap = true;
+	}
+}
+
+// Move the cursor to the next line, scrolling if required.
+void VirtualTerminal::lineFeed() {
+	_wrap = false;
+	if(_row + 1 < _rows) {
+		++_row;
+		return;
+	}
+	_scrollback.push_back(line(0));
+	_cells.erase(_cells.begin());
+	_cells.emplace_back(_columns);
+}
+
+// Erase the cells in [begin, end) of the specified row.
+void VirtualTerminal::erase(size_t row, size_t begin, size_t end) {
+	end = std::min(end, _columns);
+	// Erasing half of a wide character erases all of it.
+	if(begin && begin < end && _cells[row][begin].empty() &&
+	   Width::measure(_cells[row][begin - 1]) > 1) {
+		--begin;
+	}
+	for(size_t column = begin; column < end; ++column) {
+		_cells[row][column].clear();
+	}
+}
+
+// Retrieve parameter i of the current CSI sequence, or def if omitted.
+size_t VirtualTerminal::parameter(size_t i, size_t def) const {
+	size_t begin = 0;
+	for(; i; --i) {
+		begin = _params.find(';', begin);
+		if(begin == std::string::npos) {
+			return def;
+		}
+		++begin;
+	}
+	size_t end = std::min(_params.find(';', begin), _params.size());
+	if(begin == end) {
+		return def;
+	}
+	return size_t(std::strtoul(_params.c_str() + begin, nullptr, 10));
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
@@ -0,0 +1,109 @@
+#ifndef CONSOLE_VIRTUALTERMINAL_H
+#define CONSOLE_VIRTUALTERMINAL_H
+
+#include "output.h"
+
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                          Class VirtualTerminal                           --
+//------------------------------------------------------------------------------
+// Output interpreting the bytes written to it like a terminal, maintaining a
+// screen grid instead of displaying it. Supports the control characters and
+// CSI sequences emitted by the console; line feeds also return the cursor, as
+// with output post-processing enabled. Lines scrolled off the top of the screen
+// are kept, and bytes and escape sequences are counted per write.
+class VirtualTerminal : public Output {
+public:
+	// Construct a terminal with the specified screen size.
+	VirtualTerminal(size_t columns = 80, size_t rows = 24);
+	
+	// Interpret the specified bytes.
+	virtual void write(char const *data, size_t size) override;
+	
+	// Retrieve the screen size.
+	virtual size_t columns() const override { return _columns; }
+	size_t rows() const { return _rows; }
+	// Retrieve the cursor position.
+	size_t cursorColumn() const { return _column; }
+	size_t cursorRow() const { return _row; }
+	
+	// Retrieve the text of the specified screen row, without trailing blanks.
+	std::string line(size_t row) const;
+	// Retrieve the text of the screen rows up to the last non-empty one,
+	// separated by line feeds.
+	std::string screen() const;
+	// Retrieve the lines scrolled off the top of the screen.
+	std::vector<std::string> const &scrollback() const { return _scrollback; }
+	// Clear the screen and scrollback and home the cursor.
+	void clear();
+	
+	// Retrieve the total number of bytes, escape sequences, bells and writes.
+	size_t bytes() const { return _bytes; }
+	size_t sequences() const { return _sequences; }
+	size_t bells() const { return _bells; }
+	size_t writes() const { return _writes; }
+	// Retrieve the number of bytes and escape sequences of the last write.
+	size_t writeBytes() const { return _writeBytes; }
+	size_t writeSequences() const { return _writeSequences; }
+	// Reset all counters.
+	void resetCounters();
+	
+private:
+	// Escape sequence parser state.
+	enum class State {
+		GROUND,
+		ESCAPE,
+		CSI
+	};
+	
+private:
+	// Interpret a byte outside of escape sequences.
+	void ground(char c);
+	// Execute a complete CSI sequence.
+	void execute(char final);
+	// Place the complete codepoint in _utf8 at the cursor.
+	void print();
+	// Move the cursor to the next line, scrolling if required.
+	void lineFeed();
+	// Erase the cells in [begin, end) of the specified row.
+	void erase(size_t row, size_t begin, size_t end);
+	// Retrieve parameter i of the current CSI sequence, or def if omitted.
+	size_t parameter(size_t i, size_t def) const;
+	
+private:
+	size_t _columns;
+	size_t _rows;
+	// Cell contents by row, empty for blank cells and for the second cell of
+	// wide characters.
+	std::vector<std::vector<std::string>> _cells;
+	std::vector<std::string> _scrollback;
+	size_t _column;
+	size_t _row;
+	// Indicator of a pending wrap after writing to the last column.
+	bool _wrap;
+	
+	State _state;
+	// Parameters, intermediate and private marker of the current CSI sequence.
+	std::string _params;
+	// Partial utf8 codepoint.
+	std::string _utf8;
+	
+	size_t _bytes;
+	size_t _sequences;
+	size_t _bells;
+	size_t _writes;
+	size_t _writeBytes;
+	size_t _writeSequences;
+};
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef CONSOLE_WIDTH_H
+#define CONSOLE_WIDTH_H
+
+#include "utf8.h"
+
+#include <cstdint>
+
+//------------------------------------------------------------------------------
+//                          Begin namespace Console                           //
+namespace Console {
+
+//------------------------------------------------------------------------------
+//--                       Display Width Helper Functions                     --
+//------------------------------------------------------------------------------
+// Terminal column widths and grapheme cluster stepping. A cluster is a base
+// codepoint followed by combining marks, variation selectors, emoji modifiers
+// and zero width joined codepoints, or a pair of regional indicators. The
+// helpers accept any string type providing operator[] and size().
+namespace Width {
+	// Number of terminal columns occupied by the codepoint: 0, 1 or 2.
+	unsigned columns(uint32_t cp);
+	// Check if the codepoint extends the preceding cluster.
+	bool extends(uint32_t cp);
+	
+	// Check if the codepoint is a regional indicator.
+	inline bool regional(uint32_t cp) {
+		return cp >= 0x1f1e6 && cp <= 0x1f1ff;
+	}
+	
+	// Zero width joiner.
+	constexpr uint32_t zwj = 0x200d;
+	
+	// Next cluster starting position.
+	template<class String>
+	size_t posNext(String const &str, size_t pos) {
+		if(pos >= str.size()) {
+			return str.size();
+		}
+		bool pair = regional(Utf8::decode(str, pos));
+		pos = Utf8::posNext(str, pos);
+		while(pos < str.size()) {
+			uint32_t cp = Utf8::decode(str, pos);
+			if(cp == zwj) {
+				// Join the following codepoint.
+				pos = Utf8::posNext(str, Utf8::posNext(str, pos));
+			} else if(extends(cp) || (pair && regional(cp))) {
+				pos = Utf8::posNext(str, pos);
+			} else {
+				break;
+			}
+			pair = false;
+		}
+		return pos;
+	}
+	
+	// Previous cluster starting position.
+	template<class String>
+	size_t posPrev(String const &str, size_t pos) {
+		// Step back to a codepoint that always starts a cluster, then scan
+		// forward to find the last cluster start before pos.
+		size_t start = Utf8::posPrev(str, pos);
+		while(start) {
+			size_t prev = Utf8::posPrev(str, start);
+			uint32_t cp = Utf8::decode(str, start);
+			if(!extends(cp) && !regional(cp) && Utf8::decode(str, prev) != zwj) {
+				break;
+			}
+			start = prev;
+		}
+		for(size_t next; (next = posNext(str, start)) < pos; start = next);
+		return start;
+	}
+	
+	// Number of terminal columns occupied by the cluster in [pos, end).
+	template<class String>
+	unsigned columns(String const &str, size_t pos, size_t end) {
+		uint32_t cp = Utf8::decode(str, pos);
+		if(regional(cp) && Utf8::posNext(str, pos) < end) {
+			return 2;
+		}
+		return columns(cp);
+	}
+	
+	// Number of terminal columns occupied by the string.
+	template<class String>
+	size_t measure(String const &str) {
+		size_t n = 0;
+		for(size_t pos = 0, next; pos < str.size(); pos = next) {
+			next = posNext(str, pos);
+			n += columns(str, pos, next);
+		}
+		return n;
+	}
+}
+
+}
+//                           End namespace Console                            //
+//------------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,164 @@
+// Tests of the circular entry storage against a model.
+
+#include "arena.h"
+#include "test.h"
+
+#include <deque>
+#include <random>
+#include <string>
+
+namespace {
+
+// Check that the arena holds exactly the entries of the model.
+bool equals(Console::Arena const &arena, std::deque<std::string> const &model) {
+	if(arena.size() != model.size()) {
+		return false;
+	}
+	size_t bytes = 0;
+	for(size_t i = 0; i < model.size(); ++i) {
+		if(arena[i] != model[i]) {
+			return false;
+		}
+		bytes += model[i].size();
+	}
+	return arena.bytes() == bytes;
+}
+
+TEST(pushAndPop) {
+	Console::Arena arena(4, 1024);
+	CHECK(arena.empty());
+	for(char const *entry : { "a", "bb", "", "dddd" }) {
+		arena.push(entry);
+	}
+	CHECK(arena.size() == 4);
+	CHECK(arena.front() == "a");
+	CHECK(arena.back() == "dddd");
+	CHECK(arena[2].empty());
+	CHECK(arena.bytes() == 7);
+	CHECK(arena.full(1));
+	arena.pop();
+	CHECK(arena.front() == "bb");
+	CHECK(!arena.full(1));
+	arena.clear();
+	CHECK(arena.empty());
+	CHECK(arena.bytes() == 0);
+}
+
+TEST(removeAndCompact) {
+	Console::Arena arena(8, 1024);
+	for(char const *entry : { "one", "two", "three", "four" }) {
+		arena.push(entry);
+	}
+	arena.remove(1);
+	arena.remove(1);
+	CHECK(arena.removed() == 1);
+	CHECK(arena.removed(1));
+	CHECK(!arena.removed(0));
+	arena.compact();
+	CHECK(arena.size() == 3);
+	CHECK(arena.removed() == 0);
+	CHECK(arena[1] == "three");
+	CHECK(arena.bytes() == 12);
+}
+
+TEST(removedNotCounted) {
+	Console::Arena arena(2, 1024);
+	arena.push("a");
+	arena.push("b");
+	arena.remove(0);
+	// The removed entry leaves room for another one.
+	CHECK(!arena.full(1));
+	arena.push("c");
+	CHECK(arena.size() == 3);
+	CHECK(arena.full(1));
+	CHECK(arena[2] == "c");
+	arena.pop();
+	CHECK(arena.front() == "b");
+	CHECK(arena.full(1));
+}
+
+TEST(randomAgainstModel) {
+	std::mt19937 rng(1);
+	size_t const maxEntries = 16;
+	size_t const maxBytes = 200;
+	Console::Arena arena(maxEntries, maxBytes);
+	std::deque<std::string> model;
+	size_t modelBytes = 0;
+	bool ok = true;
+	for(size_t step = 0; step < 20000 && ok; ++step) {
+		std::string entry(rng() % 40, char('a' + step % 26));
+		if(!arena.fits(entry.size())) {
+			continue;
+		}
+		while(arena.full(entry.size())) {
+			CHECK(!model.empty());
+			modelBytes -= model.front().size();
+			model.pop_front();
+			arena.pop();
+		}
+		arena.push(entry);
+		model.push_back(entry);
+		modelBytes += entry.size();
+		ok = CHECK(equals(arena, model)) && CHECK(model.size() <= maxEntries) &&
+		     CHECK(modelBytes <= maxBytes);
+	}
+}
+
+TEST(compactInPlace) {
+	std::mt19937 rng(2);
+	Console::Arena arena(64, 256);
+	std::deque<std::string> model;
+	std::deque<bool> removed;
+	bool ok = true;
+	for(size_t step = 0; step < 20000 && ok; ++step) {
+		std::string entry(rng() % 24, char('a' + step % 26));
+		while(arena.full(entry.size())) {
+			// Compact the wrapped buffer without growing it, as a history
+			// with removed duplicates does.
+			size_t capacity = arena.capacity();
+			if(arena.removed() && rng() % 2) {
+				arena.compact();
+				for(size_t i = model.size(); i-- > 0;) {
+					if(removed[i]) {
+						model.erase(model.begin() + i);
+						removed.erase(removed.begin() + i);
+					}
+				}
+				ok = CHECK(arena.capacity() == capacity) &&
+				     CHECK(arena.removedBytes() == 0);
+			} else {
+				model.pop_front();
+				removed.pop_front();
+				arena.pop();
+			}
+		}
+		arena.push(entry);
+		model.push_back(entry);
+		removed.push_back(false);
+		if(model.size() > 1 && rng() % 3 == 0) {
+			size_t i = rng() % (model.size() - 1);
+			arena.remove(i);
+			removed[i] = true;
+		}
+		ok = ok && CHECK(equals(arena, model));
+		for(size_t i = 0; ok && i < model.size(); ++i) {
+			ok = CHECK(arena.removed(i) == removed[i]);
+		}
+	}
+}
+
+TEST(shrinkBytes) {
+	Console::Arena arena(8, 100);
+	for(char const *entry : { "aaaa", "bbbb", "cccc" }) {
+		arena.push(entry);
+	}
+	arena.pop();
+	arena.setMaxBytes(8);
+	CHECK(arena[0] == "bbbb");
+	CHECK(arena[1] == "cccc");
+	CHECK(arena.full(1));
+}
+
+}
+
+TEST_MAIN()
@@ -0,0 +1,83 @@
+// Tests of the escape sequence decoder.
+
+#include "csi.h"
+#include "test.h"
+
+#include <string_view>
+
+using Console::CSI::Key;
+
+namespace {
+
+// Decode the specified bytes following ESC, checking that the sequence is
+// only complete after its last byte.
+Key decode(Console::CSI::Decoder &decoder, std::string_view sequence) {
+	decoder.start();
+	Key key = Key::INCOMPLETE;
+	for(size_t i = 0; i < sequence.size(); ++i) {
+		key = decoder.push(sequence[i]);
+		if(i + 1 < sequence.size() && key != Key::INCOMPLETE) {
+			return Key::INVALID;
+		}
+	}
+	return key;
+}
+
+TEST(keys) {
+	Console::CSI::Decoder decoder;
+	CHECK(!decoder.active());
+	CHECK(decode(decoder, "[A") == Key::UP_ARROW);
+	CHECK(!decoder.active());
+	CHECK(decode(decoder, "[B") == Key::DOWN_ARROW);
+	CHECK(decode(decoder, "[C") == Key::RIGHT_ARROW);
+	CHECK(decode(decoder, "[D") == Key::LEFT_ARROW);
+	CHECK(decode(decoder, "[H") == Key::HOME);
+	CHECK(decode(decoder, "[F") == Key::END);
+	CHECK(decode(decoder, "OD") == Key::SHIFT_LEFT_ARROW);
+	CHECK(decode(decoder, "OH") == Key::HOME);
+	CHECK(decode(decoder, "[1~") == Key::HOME);
+	CHECK(decode(decoder, "[2~") == Key::INSERT);
+	CHECK(decode(decoder, "[3~") == Key::DEL);
+	CHECK(decode(decoder, "[4~") == Key::END);
+	CHECK(decode(decoder, "[5~") == Key::PAGE_UP);
+	CHECK(decode(decoder, "[6~") == Key::PAGE_DOWN);
+	CHECK(decode(decoder, "[200~") == Key::PASTE_BEGIN);
+	CHECK(decode(decoder, "[201~") == Key::PASTE_END);
+}
+
+TEST(modifiers) {
+	Console::CSI::Decoder decoder;
+	CHECK(decode(decoder, "[1;2C") == Key::SHIFT_RIGHT_ARROW);
+	CHECK(decoder.modifiers() == Console::CSI::SHIFT);
+	CHECK(decode(decoder, "[1;5D") == Key::SHIFT_LEFT_ARROW);
+	CHECK(decoder.modifiers() == Console::CSI::CTRL);
+	CHECK(decode(decoder, "[3;3~") == Key::DEL);
+	CHECK(decoder.modifiers() == Console::CSI::ALT);
+	CHECK(decode(decoder, "[A") == Key::UP_ARROW);
+	CHECK(decoder.modifiers() == 0);
+}
+
+TEST(invalid) {
+	Console::CSI::Decoder decoder;
+	CHECK(decode(decoder, "x") == Key::INVALID);
+	CHECK(!decoder.active());
+	CHECK(decode(decoder, "[Z") == Key::INVALID);
+	CHECK(decode(decoder, "[99~") == Key::INVALID);
+	CHECK(decode(decoder, "[1\x01") == Key::INVALID);
+	CHECK(decoder.sequence() == "[1\x01");
+	// Private markers are skipped.
+	CHECK(decode(decoder, "[?A") == Key::UP_ARROW);
+	// Overlong parameters saturate instead of overflowing.
+	CHECK(decode(decoder, "[99999999999~") == Key::INVALID);
+	CHECK(decoder.sequence().size() <= 16);
+	
+	decoder.start();
+	decoder.push('[');
+	CHECK(decoder.active());
+	decoder.reset();
+	CHECK(!decoder.active());
+}
+
+}
+
+TEST_MAIN()
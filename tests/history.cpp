@@ -0,0 +1,316 @@
+// Tests of browsing and searching the history against a simple model.
+
+#include "history.h"
+#include "test.h"
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+//------------------------------------------------------------------------------
+//--                              Class Model                                 --
+//------------------------------------------------------------------------------
+// Straightforward history keeping its entries in a deque, oldest first.
+class Model {
+public:
+	Model(size_t maxSize, bool deduplicated)
+	: _maxSize(maxSize)
+	, _deduplicated(deduplicated)
+	, _pos(0)
+	, _search(false) { }
+	
+	void push(std::string const &command) {
+		if(!_entries.empty() && _entries.back() == command) {
+			return;
+		}
+		if(_deduplicated) {
+			_entries.erase(std::remove(_entries.begin(), _entries.end(), command),
+			               _entries.end());
+		}
+		if(_entries.size() == _maxSize) {
+			_entries.pop_front();
+		}
+		_entries.push_back(command);
+		_pos = std::min(_pos, _entries.size());
+	}
+	
+	std::string current() const {
+		return _pos ? _entries[_entries.size() - _pos] : _stored;
+	}
+	
+	std::string backward(std::string const &command) {
+		if(_search) {
+			if(_stored.empty()) {
+				return _stored;
+			}
+			for(size_t pos = _pos + 1; pos <= _entries.size(); ++pos) {
+				if(matches(pos)) {
+					_pos = pos;
+					return current();
+				}
+			}
+			if(!_pos) {
+				_stored.clear();
+			}
+		} else {
+			if(!_pos) {
+				_stored = command;
+			}
+			_pos = std::min(_pos + 1, _entries.size());
+		}
+		return current();
+	}
+	
+	std::string forward(std::string const &command) {
+		if(_search) {
+			if(_stored.empty() || !_pos) {
+				return _stored;
+			}
+			for(size_t pos = _pos - 1; pos > 0; --pos) {
+				if(matches(pos)) {
+					_pos = pos;
+					break;
+				}
+			}
+		} else {
+			if(!_pos) {
+				return command;
+			}
+			--_pos;
+		}
+		return current();
+	}
+	
+	void search(std::string const &str) {
+		_stored = str;
+		_pos = 0;
+		_search = true;
+		backward(str);
+	}
+	
+	void cancel() {
+		_stored.clear();
+		_pos = 0;
+		_search = false;
+	}
+	
+	size_t size() const { return _entries.size(); }
+	
+private:
+	bool matches(size_t pos) const {
+		return _entries[_entries.size() - pos].find(_stored) != std::string::npos;
+	}
+	
+private:
+	std::deque<std::string> _entries;
+	size_t _maxSize;
+	bool _deduplicated;
+	size_t _pos;
+	std::string _stored;
+	bool _search;
+};
+
+// Apply random keys to the history and the model, returning the number of
+// steps in which their results differ.
+size_t differences(Console::History &history, Model &model, size_t steps,
+                   size_t commands, unsigned seed) {
+	std::mt19937 rng(seed);
+	auto command = [&] {
+		return "cmd " + std::to_string(rng() % commands);
+	};
+	size_t differences = 0;
+	std::string query;
+	for(size_t step = 0; step < steps; ++step) {
+		std::string expected;
+		std::string actual;
+		switch(rng() % 6) {
+		case 0:
+		case 1: {
+			// Enter a command while possibly browsing, as the console does.
+			std::string c = command();
+			history.push(c);
+			model.push(c);
+			history.cancel();
+			model.cancel();
+			query.clear();
+			break; }
+		case 2:
+			expected = model.backward("typed");
+			actual = history.backward("typed");
+			break;
+		case 3:
+			expected = model.forward("typed");
+			actual = history.forward("typed");
+			break;
+		case 4:
+			// Extend or start a search string.
+			query += "cmd 1234567890"[rng() % 14];
+			model.search(query);
+			history.search(query);
+			expected = model.current();
+			actual = history.current();
+			break;
+		default:
+			history.cancel();
+			model.cancel();
+			query.clear();
+			break;
+		}
+		if(expected != actual || history.size() != model.size()) {
+			++differences;
+		}
+	}
+	return differences;
+}
+
+TEST(browse) {
+	Console::History history(4);
+	CHECK(history.backward("typed") == "typed");
+	for(char const *command : { "a", "b", "b", "c" }) {
+		history.push(command);
+	}
+	CHECK(history.size() == 3);
+	CHECK(history.backward("typed") == "c");
+	CHECK(history.backward("ignored") == "b");
+	CHECK(history.backward("ignored") == "a");
+	CHECK(history.backward("ignored") == "a");
+	CHECK(history.forward("ignored") == "b");
+	CHECK(history.forward("ignored") == "c");
+	CHECK(history.forward("ignored") == "typed");
+	history.cancel();
+	for(char const *command : { "d", "e" }) {
+		history.push(command);
+	}
+	CHECK(history.size() == 4);
+	CHECK(history.backward("") == "e");
+	CHECK(history.backward("") == "d");
+	CHECK(history.backward("") == "c");
+	CHECK(history.backward("") == "b");
+	CHECK(history.backward("") == "b");
+}
+
+TEST(search) {
+	Console::History history(16);
+	for(char const *command : { "make", "git status", "ls", "git commit" }) {
+		history.push(command);
+	}
+	history.search("git");
+	CHECK(history.searching());
+	CHECK(history.current() == "git commit");
+	CHECK(history.backward("") == "git status");
+	CHECK(history.backward("") == "git status");
+	CHECK(history.forward("") == "git commit");
+	history.search("git s");
+	CHECK(history.current() == "git status");
+	history.search("svn");
+	CHECK(history.current().empty());
+	history.cancel();
+	CHECK(!history.searching());
+}
+
+TEST(randomAgainstModel) {
+	for(unsigned seed = 0; seed < 4; ++seed) {
+		Console::History history(8);
+		Model model(8, false);
+		CHECK(differences(history, model, 2000, 12, seed) == 0);
+	}
+}
+
+TEST(indexedAgainstModel) {
+	Console::History history(64);
+	history.setIndexed(true);
+	Model model(64, false);
+	CHECK(differences(history, model, 4000, 200, 7) == 0);
+}
+
+TEST(deduplicated) {
+	Console::History history(4);
+	history.setDeduplicated(true);
+	for(char const *command : { "a", "b", "a", "c", "b", "d", "e" }) {
+		history.push(command);
+	}
+	// Duplicates do not take up room, so four distinct entries are kept.
+	CHECK(history.size() == 4);
+	CHECK(history.backward("") == "e");
+	CHECK(history.backward("") == "d");
+	CHECK(history.backward("") == "b");
+	CHECK(history.backward("") == "c");
+	CHECK(history.backward("") == "c");
+}
+
+TEST(deduplicatedLoad) {
+	std::string path = (std::filesystem::temp_directory_path() /
+	                    ("console-test-history-" +
+	                     std::to_string(std::random_device()()))).string();
+	{
+		std::ofstream file(path);
+		file << "a\nb\nc\nb\nc\nb\nc\n";
+	}
+	// The repeated tail still leaves room for the older distinct entry.
+	Console::History history(3);
+	history.setDeduplicated(true);
+	history.load(path, false);
+	std::filesystem::remove(path);
+	CHECK(history.size() == 3);
+	CHECK(history.backward("") == "c");
+	CHECK(history.backward("") == "b");
+	CHECK(history.backward("") == "a");
+}
+
+TEST(deduplicatedAgainstModel) {
+	for(unsigned seed = 0; seed < 4; ++seed) {
+		Console::History history(8);
+		history.setDeduplicated(true);
+		Model model(8, true);
+		CHECK(differences(history, model, 2000, 12, seed) == 0);
+	}
+	Console::History history(32);
+	history.setDeduplicated(true);
+	history.setIndexed(true);
+	Model model(32, true);
+	CHECK(differences(history, model, 4000, 40, 9) == 0);
+}
+
+TEST(fuzzy) {
+	Console::History history(16);
+	history.setFuzzy(true);
+	for(char const *command : { "git commit", "grep main", "gcc -c x.c" }) {
+		history.push(command);
+	}
+	history.search("gc");
+	std::vector<std::string_view> ranked = history.ranked();
+	CHECK(ranked.size() == 2);
+	CHECK(!ranked.empty() && ranked.front() == "gcc -c x.c");
+	history.search("zz");
+	CHECK(history.ranked().empty());
+}
+
+#if defined(__linux__)
+TEST(journalFails) {
+	// Every write to /dev/full fails for want of space.
+	Console::History history(16);
+	history.journal("/dev/full", false);
+	history.push("a");
+	bool reported = false;
+	try {
+		history.sync();
+	} catch(std::runtime_error const &) {
+		reported = true;
+	}
+	CHECK(reported);
+	CHECK(history.size() == 1);
+	
+	// The failure is reported once.
+	history.sync();
+}
+#endif
+
+}
+
+TEST_MAIN()
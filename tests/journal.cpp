@@ -0,0 +1,122 @@
+// Tests of journal compaction and of its failures.
+
+#include "journal.h"
+#include "test.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Temporary journal path, removed along with its compaction file.
+struct TempPath {
+	TempPath()
+	: path((std::filesystem::temp_directory_path() / ("console-test-journal-" +
+	        std::to_string(std::random_device()()))).string()) {
+		clear();
+	}
+	~TempPath() { clear(); }
+	
+	void clear() {
+		std::error_code error;
+		std::filesystem::remove_all(path, error);
+		std::filesystem::remove_all(path + ".tmp", error);
+	}
+	
+	std::string const path;
+};
+
+// Retrieve the lines of the specified file.
+std::vector<std::string> lines(std::string const &path) {
+	std::vector<std::string> lines;
+	std::ifstream file(path);
+	for(std::string line; std::getline(file, line);) {
+		lines.push_back(line);
+	}
+	return lines;
+}
+
+}
+
+TEST(compacts) {
+	TempPath temp;
+	{
+		Console::Journal journal(temp.path, 4);
+		for(int i = 0; i < 20; ++i) {
+			journal.append(std::to_string(i));
+			journal.sync();
+		}
+		// Entries are appended to the compacted file.
+		std::vector<std::string> written = lines(temp.path);
+		CHECK(written.size() <= 8);
+		CHECK(!written.empty() && written.back() == "19");
+	}
+	
+	// The file is compacted when opened.
+	{
+		std::ofstream file(temp.path);
+		for(int i = 0; i < 20; ++i) {
+			file << i << '\n';
+		}
+	}
+	{
+		Console::Journal journal(temp.path, 4);
+		journal.append("20");
+	}
+	std::vector<std::string> written = lines(temp.path);
+	CHECK(written.size() == 5);
+	CHECK(written.front() == "16" && written.back() == "20");
+}
+
+TEST(compactionFails) {
+	TempPath temp;
+	// Prevent creating the compacted file.
+	std::filesystem::create_directory(temp.path + ".tmp");
+	{
+		Console::Journal journal(temp.path, 4);
+		for(int i = 0; i < 20; ++i) {
+			journal.append(std::to_string(i));
+			journal.sync();
+		}
+	}
+	// No entry is lost while compaction fails.
+	std::vector<std::string> written = lines(temp.path);
+	CHECK(written.size() == 20);
+	CHECK(!written.empty() && written.back() == "19");
+	
+	// Compaction succeeds once possible again.
+	std::filesystem::remove(temp.path + ".tmp");
+	{
+		Console::Journal journal(temp.path, 4);
+		journal.append("20");
+	}
+	written = lines(temp.path);
+	CHECK(written.size() == 5);
+	CHECK(!written.empty() && written.back() == "20");
+}
+
+#if defined(__linux__)
+TEST(writeFails) {
+	// Every write to /dev/full fails for want of space.
+	Console::Journal journal("/dev/full", 4, std::chrono::milliseconds(1));
+	journal.append("a");
+	// A failed background write is reported by a subsequent append.
+	bool reported = false;
+	for(int i = 0; i < 1000 && !reported; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		try {
+			journal.append("b");
+		} catch(std::runtime_error const &) {
+			reported = true;
+		}
+	}
+	CHECK(reported);
+}
+#endif
+
+TEST_MAIN()
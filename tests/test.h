@@ -0,0 +1,70 @@
+#ifndef CONSOLE_TEST_H
+#define CONSOLE_TEST_H
+
+#include <cstdio>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//--                              Test Harness                                --
+//------------------------------------------------------------------------------
+// Every test executable defines its cases with TEST, checks conditions with
+// CHECK and runs all cases with TEST_MAIN, failing if any check failed.
+namespace Test {
+	struct Case {
+		char const *name;
+		void (*run)();
+	};
+	
+	// Retrieve all registered cases.
+	inline std::vector<Case> &cases() {
+		static std::vector<Case> cases;
+		return cases;
+	}
+	// Retrieve the number of failed checks.
+	inline size_t &failures() {
+		static size_t failures = 0;
+		return failures;
+	}
+	
+	// Registers a case on construction.
+	struct Registration {
+		Registration(char const *name, void (*run)()) {
+			cases().push_back({ name, run });
+		}
+	};
+	
+	// Record a failed check.
+	inline bool check(bool ok, char const *condition, char const *file,
+	                  int line) {
+		if(!ok) {
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line,
+			             condition);
+			++failures();
+		}
+		return ok;
+	}
+	
+	// Run all registered cases, returning the process exit code.
+	inline int run() {
+		for(Case const &c : cases()) {
+			size_t failed = failures();
+			c.run();
+			std::printf("%-40s %s\n", c.name,
+			            failures() == failed ? "ok" : "FAILED");
+		}
+		return failures() ? 1 : 0;
+	}
+}
+
+#define TEST(name) \
+	void name(); \
+	Test::Registration name##Registration(#name, name); \
+	void name()
+
+#define CHECK(condition) \
+	Test::check(bool(condition), #condition, __FILE__, __LINE__)
+
+#define TEST_MAIN() \
+	int main() { return Test::run(); }
+
+#endif
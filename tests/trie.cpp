@@ -0,0 +1,104 @@
+// Tests of the completion trie against a sorted set.
+
+#include "trie.h"
+#include "test.h"
+
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Retrieve the words of the model starting with prefix.
+std::vector<std::string> withPrefix(std::set<std::string> const &model,
+                                    std::string const &prefix) {
+	std::vector<std::string> words;
+	for(auto it = model.lower_bound(prefix);
+	    it != model.end() && it->compare(0, prefix.size(), prefix) == 0; ++it) {
+		words.push_back(*it);
+	}
+	return words;
+}
+
+// Retrieve the longest common prefix of the specified words.
+std::string commonPrefix(std::vector<std::string> const &words) {
+	if(words.empty()) {
+		return "";
+	}
+	std::string prefix = words.front();
+	for(std::string const &word : words) {
+		size_t n = 0;
+		while(n < prefix.size() && n < word.size() && prefix[n] == word[n]) {
+			++n;
+		}
+		prefix.resize(n);
+	}
+	return prefix;
+}
+
+TEST(basics) {
+	Console::Trie trie;
+	CHECK(trie.empty());
+	for(char const *word : { "help", "history", "hosts", "quit", "his" }) {
+		trie.insert(word);
+	}
+	trie.insert("help");
+	CHECK(trie.size() == 5);
+	CHECK(trie.contains("his"));
+	CHECK(!trie.contains("hi"));
+	CHECK(!trie.contains("helps"));
+	CHECK(trie.count("h") == 4);
+	CHECK(trie.count("his") == 2);
+	CHECK(trie.count("x") == 0);
+	CHECK(trie.commonPrefix("hi") == "his");
+	CHECK(trie.commonPrefix("q") == "quit");
+	CHECK(trie.commonPrefix("z").empty());
+	
+	std::vector<std::string> words;
+	trie.list("h", 1, 2, words);
+	CHECK((words == std::vector<std::string> { "his", "history" }));
+	trie.clear();
+	CHECK(trie.empty());
+	CHECK(!trie.contains("help"));
+}
+
+TEST(randomAgainstModel) {
+	std::mt19937 rng(2);
+	Console::Trie trie;
+	std::set<std::string> model;
+	auto word = [&] {
+		std::string w(1 + rng() % 6, 'a');
+		for(char &c : w) {
+			c = char('a' + rng() % 3);
+		}
+		return w;
+	};
+	for(size_t i = 0; i < 500; ++i) {
+		std::string w = word();
+		trie.insert(w);
+		model.insert(w);
+	}
+	CHECK(trie.size() == model.size());
+	for(size_t i = 0; i < 300; ++i) {
+		std::string prefix = word().substr(0, rng() % 4);
+		std::vector<std::string> expected = withPrefix(model, prefix);
+		CHECK(trie.count(prefix) == expected.size());
+		CHECK(trie.commonPrefix(prefix) == commonPrefix(expected));
+		CHECK(trie.contains(prefix) == (model.count(prefix) > 0));
+		
+		size_t offset = rng() % (expected.size() + 1);
+		size_t limit = rng() % 10;
+		std::vector<std::string> words;
+		trie.list(prefix, offset, limit, words);
+		std::vector<std::string> page(
+			expected.begin() + offset,
+			expected.begin() + std::min(expected.size(), offset + limit)
+		);
+		CHECK(words == page);
+	}
+}
+
+}
+
+TEST_MAIN()
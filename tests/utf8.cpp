@@ -0,0 +1,134 @@
+// Tests of the utf8 helpers, comparing the vectorized bulk functions with
+// scalar references across chunk boundaries.
+
+#include "utf8.h"
+#include "test.h"
+
+#include <random>
+#include <string>
+
+namespace {
+
+// Encode the specified codepoint.
+void encode(std::string &str, uint32_t cp) {
+	if(cp < 0x80) {
+		str += char(cp);
+	} else if(cp < 0x800) {
+		str += char(0xc0 | cp >> 6);
+		str += char(0x80 | (cp & 0x3f));
+	} else if(cp < 0x10000) {
+		str += char(0xe0 | cp >> 12);
+		str += char(0x80 | (cp >> 6 & 0x3f));
+		str += char(0x80 | (cp & 0x3f));
+	} else {
+		str += char(0xf0 | cp >> 18);
+		str += char(0x80 | (cp >> 12 & 0x3f));
+		str += char(0x80 | (cp >> 6 & 0x3f));
+		str += char(0x80 | (cp & 0x3f));
+	}
+}
+
+// Retrieve a random string of mostly ascii codepoints.
+std::string text(std::mt19937 &rng, size_t codepoints) {
+	std::string str;
+	for(size_t i = 0; i < codepoints; ++i) {
+		switch(rng() % 8) {
+		case 0:  encode(str, 0x80 + rng() % 0x780); break;
+		case 1:  encode(str, 0x800 + rng() % 0xd000); break;
+		case 2:  encode(str, 0x10000 + rng() % 0x100000); break;
+		default: encode(str, 0x20 + rng() % 0x5f); break;
+		}
+	}
+	return str;
+}
+
+// Check if the string is well-formed utf8 by decoding it one codepoint at a
+// time, following Table 3-7 of the Unicode standard.
+bool referenceValid(std::string const &str) {
+	for(size_t i = 0; i < str.size();) {
+		unsigned char c = str[i];
+		size_t n = c < 0x80 ? 1 : c < 0xc2 ? 0 : c < 0xe0 ? 2 : c < 0xf0 ? 3
+		         : c < 0xf5 ? 4 : 0;
+		if(!n || i + n > str.size()) {
+			return false;
+		}
+		uint32_t cp = n == 1 ? c : c & (0x7f >> n);
+		for(size_t j = 1; j < n; ++j) {
+			unsigned char d = str[i + j];
+			if((d & 0xc0) != 0x80) {
+				return false;
+			}
+			cp = cp << 6 | (d & 0x3f);
+		}
+		uint32_t const minimum[] { 0, 0, 0x80, 0x800, 0x10000 };
+		if(cp < minimum[n] || cp > 0x10ffff || (cp >= 0xd800 && cp < 0xe000)) {
+			return false;
+		}
+		i += n;
+	}
+	return true;
+}
+
+TEST(countAndAdvance) {
+	std::mt19937 rng(3);
+	for(size_t codepoints = 0; codepoints < 200; ++codepoints) {
+		std::string str = text(rng, codepoints);
+		CHECK(Console::Utf8::count(str) == codepoints);
+		CHECK(Console::Utf8::count(str.c_str(), str.size()) ==
+		      Console::Utf8::count<std::string>(str));
+		
+		size_t n = codepoints ? rng() % codepoints : 0;
+		size_t pos = 0;
+		for(size_t i = 0; i < n; ++i) {
+			pos = Console::Utf8::posNext(str, pos);
+		}
+		CHECK(Console::Utf8::advance(str, 0, n) == pos);
+		CHECK(Console::Utf8::advance(str, 0, codepoints + 5) == str.size());
+	}
+}
+
+TEST(valid) {
+	std::mt19937 rng(4);
+	for(size_t i = 0; i < 3000; ++i) {
+		std::string str = text(rng, rng() % 80);
+		CHECK(Console::Utf8::valid(str));
+		// Corrupt a random octet, possibly at a chunk boundary.
+		if(!str.empty()) {
+			str[rng() % str.size()] = char(rng());
+		}
+		CHECK(Console::Utf8::valid(str) == referenceValid(str));
+	}
+	CHECK(!Console::Utf8::valid("\xc0\x80"));
+	CHECK(!Console::Utf8::valid("\xed\xa0\x80"));
+	CHECK(!Console::Utf8::valid("\xf4\x90\x80\x80"));
+	CHECK(!Console::Utf8::valid(std::string(40, 'a') + "\xe2\x82"));
+	CHECK(Console::Utf8::valid(std::string(40, 'a') + "\xe2\x82\xac"));
+}
+
+TEST(printable) {
+	std::mt19937 rng(5);
+	for(size_t i = 0; i < 3000; ++i) {
+		std::string str = text(rng, rng() % 80);
+		size_t run = 0;
+		while(run < str.size() && str[run] >= 0x20 && str[run] < 0x7f) {
+			++run;
+		}
+		CHECK(Console::Utf8::printable(str.data(), str.size()) == run);
+	}
+	CHECK(Console::Utf8::printable(std::string(40, 'a').data(), 40) == 40);
+	CHECK(Console::Utf8::printable(
+		(std::string(20, 'a') + '\x7f' + "a").data(), 22
+	) == 20);
+	CHECK(Console::Utf8::printable("\t", 1) == 0);
+}
+
+TEST(decode) {
+	CHECK(Console::Utf8::decode(std::string("\xe2\x82\xac"), 0) == 0x20ac);
+	CHECK(Console::Utf8::decode(std::string("\xf0\x9f\x98\x80"), 0) == 0x1f600);
+	CHECK(Console::Utf8::decode(std::string("\xe2\x82"), 0) == 0xfffd);
+	CHECK(Console::Utf8::posPrev(std::string("a\xe2\x82\xac"), 4) == 1);
+}
+
+}
+
+TEST_MAIN()
@@ -0,0 +1,246 @@
+// Tests of the virtual terminal, replaying output and checking the screen.
+
+#include "console.h"
+#include "virtualterminal.h"
+#include "test.h"
+
+#include <string>
+
+namespace {
+
+// Write the specified bytes to the terminal.
+void replay(Console::VirtualTerminal &terminal, std::string const &bytes) {
+	terminal.write(bytes.data(), bytes.size());
+}
+
+// Console discarding entered commands.
+class TestConsole : public Console::Console {
+public:
+	TestConsole(::Console::Output &output)
+	: Console(100, output, 0, false) { }
+	
+	using Console::vocabulary;
+	
+private:
+	virtual void onCommand(std::string) override { }
+};
+
+// Fill the rows of the terminal with their row letter.
+void fill(Console::VirtualTerminal &terminal) {
+	replay(terminal, "\033[Haaaaa\r\nbbbbb\r\nccccc");
+}
+
+}
+
+TEST(wrapPending) {
+	Console::VirtualTerminal terminal(5, 3);
+	replay(terminal, "abcde");
+	// The cursor stays on the last column until the next character.
+	CHECK(terminal.screen() == "abcde");
+	CHECK(terminal.cursorRow() == 0 && terminal.cursorColumn() == 4);
+	replay(terminal, "f");
+	CHECK(terminal.screen() == "abcde\nf");
+	CHECK(terminal.cursorRow() == 1 && terminal.cursorColumn() == 1);
+	
+	// Carriage returns and cursor movement cancel the pending wrap.
+	terminal.clear();
+	replay(terminal, "abcde\rX");
+	CHECK(terminal.screen() == "Xbcde");
+	terminal.clear();
+	replay(terminal, "abcde\033[DX");
+	CHECK(terminal.screen() == "abcXe");
+	CHECK(terminal.cursorRow() == 0 && terminal.cursorColumn() == 4);
+	
+	// Wide characters not fitting the row wrap before printing.
+	terminal.clear();
+	replay(terminal, "abcd\xe4\xb8\xad");
+	CHECK(terminal.screen() == "abcd\n\xe4\xb8\xad");
+	CHECK(terminal.cursorRow() == 1 && terminal.cursorColumn() == 2);
+	
+	// Wrapping on the last row scrolls.
+	terminal.clear();
+	replay(terminal, "abcdefghijklmnop");
+	CHECK(terminal.screen() == "fghij\nklmno\np");
+	CHECK(terminal.scrollback().size() == 1 &&
+	      terminal.scrollback()[0] == "abcde");
+}
+
+TEST(wideErase) {
+	Console::VirtualTerminal terminal(10, 2);
+	replay(terminal, "a\xe4\xb8\xad" "b");
+	CHECK(terminal.screen() == "a\xe4\xb8\xad" "b");
+	CHECK(terminal.cursorColumn() == 4);
+	
+	// Overwriting the second half of a wide character erases all of it.
+	replay(terminal, "\033[3Gx");
+	CHECK(terminal.screen() == "a xb");
+	CHECK(terminal.cursorColumn() == 3);
+	
+	// Erasing from the second half of a wide character erases all of it.
+	terminal.clear();
+	replay(terminal, "a\xe4\xb8\xad" "b\033[3G\033[K");
+	CHECK(terminal.screen() == "a");
+	CHECK(terminal.cursorColumn() == 2);
+	
+	// Overwriting the first half leaves no half character behind.
+	terminal.clear();
+	replay(terminal, "a\xe4\xb8\xad" "b\033[2Gx");
+	CHECK(terminal.screen() == "ax b");
+}
+
+TEST(zeroWidthAttach) {
+	Console::VirtualTerminal terminal(5, 2);
+	// Combining marks attach to the preceding cell.
+	replay(terminal, "e\xcc\x81x");
+	CHECK(terminal.screen() == "e\xcc\x81x");
+	CHECK(terminal.cursorColumn() == 2);
+	
+	// And to both cells of a wide character.
+	terminal.clear();
+	replay(terminal, "\xe4\xb8\xad\xcc\x81x");
+	CHECK(terminal.screen() == "\xe4\xb8\xad\xcc\x81x");
+	CHECK(terminal.cursorColumn() == 3);
+	
+	// And to the last column while a wrap is pending.
+	terminal.clear();
+	replay(terminal, "abcde\xcc\x81");
+	CHECK(terminal.screen() == "abcde\xcc\x81");
+	CHECK(terminal.cursorRow() == 0 && terminal.cursorColumn() == 4);
+	replay(terminal, "f");
+	CHECK(terminal.screen() == "abcde\xcc\x81\nf");
+}
+
+TEST(eraseModes) {
+	Console::VirtualTerminal terminal(5, 3);
+	
+	// Erase in line: to the end, to the start and all of it.
+	fill(terminal);
+	replay(terminal, "\033[2;3H\033[K");
+	CHECK(terminal.screen() == "aaaaa\nbb\nccccc");
+	fill(terminal);
+	replay(terminal, "\033[2;3H\033[1K");
+	CHECK(terminal.screen() == "aaaaa\n   bb\nccccc");
+	replay(terminal, "\033[2K");
+	CHECK(terminal.screen() == "aaaaa\n\nccccc");
+	CHECK(terminal.cursorRow() == 1 && terminal.cursorColumn() == 2);
+	
+	// Erase in display: to the end, to the start and all of it.
+	terminal.clear();
+	fill(terminal);
+	replay(terminal, "\033[2;3H\033[J");
+	CHECK(terminal.screen() == "aaaaa\nbb");
+	terminal.clear();
+	fill(terminal);
+	replay(terminal, "\033[2;3H\033[1J");
+	CHECK(terminal.screen() == "\n   bb\nccccc");
+	replay(terminal, "\033[2J");
+	CHECK(terminal.screen().empty());
+	CHECK(terminal.cursorRow() == 1 && terminal.cursorColumn() == 2);
+}
+
+TEST(writeSequences) {
+	Console::VirtualTerminal terminal(20, 2);
+	replay(terminal, "\033[31mred\033[0m\033[2K\033[?2004h");
+	CHECK(terminal.writeSequences() == 4);
+	CHECK(terminal.writeBytes() == 24);
+	// Private modes leave the screen unchanged.
+	CHECK(terminal.screen().empty());
+	
+	// Erasing leaves the cursor in place.
+	replay(terminal, "plain");
+	CHECK(terminal.writeSequences() == 0);
+	CHECK(terminal.screen() == "   plain");
+	
+	// Sequences count in the write completing them.
+	replay(terminal, "\033[");
+	CHECK(terminal.writeSequences() == 0);
+	replay(terminal, "D");
+	CHECK(terminal.writeSequences() == 1);
+	CHECK(terminal.cursorColumn() == 7);
+	CHECK(terminal.sequences() == 5);
+	CHECK(terminal.writes() == 4);
+}
+
+TEST(consoleReplay) {
+	Console::VirtualTerminal terminal(40, 5);
+	TestConsole console(terminal);
+	CHECK(terminal.screen() == ": ");
+	CHECK(terminal.cursorColumn() == 2);
+	
+	// Typing at the end of the line appends to the screen.
+	console.feed("hello");
+	CHECK(terminal.line(0) == ": hello");
+	CHECK(terminal.cursorColumn() == 7);
+	CHECK(terminal.writeSequences() <= 2);
+	
+	// Editing in the middle rewrites the tail.
+	console.feed("\033[D\033[D\xe4\xb8\xad");
+	CHECK(terminal.line(0) == ": hel\xe4\xb8\xadlo");
+	CHECK(terminal.cursorColumn() == 7);
+	console.feed("\x7f\x7f");
+	CHECK(terminal.line(0) == ": helo");
+	CHECK(terminal.cursorColumn() == 4);
+	
+	// Moving the cursor only moves the cursor.
+	console.feed("\033[C");
+	CHECK(terminal.line(0) == ": helo");
+	CHECK(terminal.cursorColumn() == 5);
+	CHECK(terminal.writeBytes() == 3);
+	
+	// Entering the command starts a new prompt.
+	console.feed("\r");
+	CHECK(terminal.screen() == ": helo\n: ");
+	CHECK(terminal.cursorRow() == 1 && terminal.cursorColumn() == 2);
+}
+
+TEST(asciiRun) {
+	Console::VirtualTerminal terminal(40, 5);
+	TestConsole console(terminal);
+	// The last octet of a printable run joins a following combining mark.
+	console.feed("abcde\xcc\x81" "fg");
+	CHECK(terminal.line(0) == ": abcde\xcc\x81" "fg");
+	CHECK(terminal.cursorColumn() == 9);
+	console.feed("\033[D\033[D\033[D\x7f");
+	CHECK(terminal.line(0) == ": abce\xcc\x81" "fg");
+	CHECK(terminal.cursorColumn() == 5);
+}
+
+TEST(completionColumns) {
+	// Candidates are listed in as many columns as fit the terminal.
+	Console::VirtualTerminal terminal(20, 6);
+	TestConsole console(terminal);
+	for(char const *word : { "alpha", "alpine", "altar", "alto" }) {
+		console.vocabulary().insert(word);
+	}
+	console.feed("al\t\t");
+	CHECK(terminal.line(0) == "alpha   alpine");
+	CHECK(terminal.line(1) == "altar   alto");
+	CHECK(terminal.line(2) == ": al");
+}
+
+TEST(pasteEnter) {
+	Console::VirtualTerminal terminal(40, 5);
+	TestConsole console(terminal);
+	console.setPastePolicy(Console::Console::PastePolicy::ENTER);
+	console.feed("\033[200~a\nb\033[201~");
+	CHECK(terminal.screen() == ": a\n: b");
+	// A line feed following the paste is not taken for the end of a CR LF
+	// pair, so it submits the line.
+	console.feed("\nx");
+	CHECK(terminal.screen() == ": a\n: b\n: x");
+}
+
+TEST(malformedPaste) {
+	Console::VirtualTerminal terminal(40, 5);
+	TestConsole console(terminal);
+	// Malformed utf8 is pasted as replacement characters.
+	console.feed("\033[200~a\xff\xe4\xb8" "b\xe4\xb8\xad\033[201~");
+	CHECK(terminal.line(0) ==
+	      ": a\xef\xbf\xbd\xef\xbf\xbd\xef\xbf\xbd" "b\xe4\xb8\xad");
+	CHECK(terminal.cursorColumn() == 9);
+	console.feed("\x7f\x7f\x7f");
+	CHECK(terminal.line(0) == ": a\xef\xbf\xbd\xef\xbf\xbd");
+	CHECK(terminal.cursorColumn() == 5);
+}
+
+TEST_MAIN()